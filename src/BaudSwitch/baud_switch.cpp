@@ -0,0 +1,260 @@
+#include "baud_switch.h"
+#include "convert.h"
+
+
+BaudSwitch::BaudSwitch(Clock clock) :
+    m_clock(clock)
+{
+
+}
+
+void BaudSwitch::output(Output out)
+{
+    m_output = out;
+}
+
+void BaudSwitch::onBaud(std::function<void(uint32_t baud)> foo)
+{
+    m_onBaud = foo;
+}
+
+void BaudSwitch::onResult(std::function<void(BaudSwitchResult result, uint32_t baud)> foo)
+{
+    m_onResult = foo;
+}
+
+void BaudSwitch::begin(uint32_t baud)
+{
+    m_baud = baud;
+    m_defaultBaud = baud;
+    m_stats.baud = baud;
+    m_state = STATE_IDLE;
+    m_rxTime = m_clock();
+}
+
+void BaudSwitch::setRange(uint32_t minBaud, uint32_t maxBaud)
+{
+    m_minBaud = minBaud;
+    m_maxBaud = maxBaud;
+}
+
+void BaudSwitch::setTimeouts(uint32_t ackMs, uint32_t confirmMs)
+{
+    m_ackMs = ackMs;
+    m_confirmMs = confirmMs;
+}
+
+BaudSwitchResult BaudSwitch::request(uint32_t baud)
+{
+    if (m_state != STATE_IDLE) {
+        return BAUD_SWITCH_BUSY;
+    }
+    if (!_supported(baud)) {
+        return BAUD_SWITCH_UNSUPPORTED;
+    }
+
+    ++m_stats.requests;
+    m_initiator = true;
+    m_collision = false;
+    m_oldBaud = m_baud;
+    m_newBaud = baud;
+    m_state = STATE_WAIT_ACK;
+    m_stateTime = m_clock();
+    _send(BAUD_SWITCH_OP_REQUEST, baud);
+    return BAUD_SWITCH_OK;
+}
+
+
+// frames -----------------------------------------------------------------------------
+bool BaudSwitch::input(int len, uint8_t* data)
+{
+    // every valid frame from peer shows that current baud works
+    m_rxTime = m_clock();
+
+    if (len < 1 || data[0] != BAUD_SWITCH_CMD) {
+        return false;
+    }
+
+    frame(len - 1, data + 1);
+    return true;
+}
+
+void BaudSwitch::frame(int len, uint8_t* data)
+{
+    m_rxTime = m_clock();
+    if (len < (BAUD_SWITCH_FRAME_SIZE - 1)) {
+        return;
+    }
+
+    unsigned int pos = 0;
+    const uint8_t op = Convert::FB::readU8(data, &pos);
+    const uint32_t baud = Convert::FB::readU32(data, &pos);
+
+    switch (op) {
+    case BAUD_SWITCH_OP_REQUEST:
+        if (m_state != STATE_IDLE && m_initiator) {
+            // both sides asked at once: lower baud request wins, other side becomes responder
+            if (baud == m_newBaud && m_state == STATE_WAIT_ACK) {
+                // same baud: peer REQUEST is taken as ACK on both sides, each answers first
+                // CONFIRM of the other while it waits for one
+                m_collision = true;
+                _accepted(baud);
+                return;
+            }
+            if (baud >= m_newBaud) {
+                return;
+            }
+            _apply(m_oldBaud);
+        }
+
+        if (!_supported(baud)) {
+            ++m_stats.naks;
+            _send(BAUD_SWITCH_OP_NAK, baud);
+            return;
+        }
+
+        m_initiator = false;
+        m_collision = false;
+        m_oldBaud = m_baud;
+        m_newBaud = baud;
+        _send(BAUD_SWITCH_OP_ACK, baud);
+        _apply(baud);
+        m_state = STATE_WAIT_CONFIRM;
+        m_stateTime = m_clock();
+        break;
+
+    case BAUD_SWITCH_OP_ACK:
+        if (m_state != STATE_WAIT_ACK || baud != m_newBaud) {
+            return;
+        }
+        _accepted(baud);
+        break;
+
+    case BAUD_SWITCH_OP_NAK:
+        if (m_state != STATE_WAIT_ACK || baud != m_newBaud) {
+            return;
+        }
+        ++m_stats.naks;
+        _finish(BAUD_SWITCH_UNSUPPORTED);
+        break;
+
+    case BAUD_SWITCH_OP_CONFIRM:
+        if (baud != m_baud) {
+            return;
+        }
+        if (!m_initiator || (m_collision && m_state == STATE_WAIT_CONFIRM)) {
+            // responder answers every CONFIRM, also repeated ones after it is done
+            _send(BAUD_SWITCH_OP_CONFIRM, baud);
+        }
+        if (m_state == STATE_WAIT_CONFIRM) {
+            ++m_stats.switches;
+            _finish(BAUD_SWITCH_OK);
+        }
+        break;
+
+    case BAUD_SWITCH_OP_REVERT:
+        // only back from last switch, frame came at new baud
+        if (m_initiator && !m_collision) {
+            return;
+        }
+        if (baud != m_oldBaud || baud == m_baud) {
+            return;
+        }
+        ++m_stats.reverts;
+        _apply(baud);
+        _finish(BAUD_SWITCH_NO_CONFIRM);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void BaudSwitch::proceed()
+{
+    const uint32_t now = m_clock();
+
+    switch (m_state) {
+    case STATE_WAIT_ACK:
+        if ((now - m_stateTime) > m_ackMs) {
+            ++m_stats.noAck;
+            _finish(BAUD_SWITCH_NO_ACK);
+        }
+        return;
+
+    case STATE_WAIT_CONFIRM:
+        if ((now - m_stateTime) > m_confirmMs) {
+            ++m_stats.noConfirm;
+            if (m_initiator) {
+                // peer may have CONFIRM already and only its answers were lost
+                _send(BAUD_SWITCH_OP_REVERT, m_oldBaud);
+            }
+            _apply(m_oldBaud);
+            _finish(BAUD_SWITCH_NO_CONFIRM);
+            return;
+        }
+        if (m_initiator && (now - m_retryTime) >= BAUD_SWITCH_RETRY_MS) {
+            m_retryTime = now;
+            _send(BAUD_SWITCH_OP_CONFIRM, m_baud);
+        }
+        return;
+
+    default:
+        break;
+    }
+
+    if (m_watchdogMs && m_baud != m_defaultBaud && (now - m_rxTime) > m_watchdogMs) {
+        ++m_stats.watchdog;
+        _apply(m_defaultBaud);
+        m_rxTime = now;
+        if (m_onResult) {
+            m_onResult(BAUD_SWITCH_WATCHDOG, m_baud);
+        }
+    }
+}
+
+void BaudSwitch::_send(uint8_t op, uint32_t baud)
+{
+    if (!m_output) {
+        return;
+    }
+
+    uint8_t frame[BAUD_SWITCH_FRAME_SIZE] = {0};
+    unsigned int pos = 0;
+    Convert::FB::writeU8(frame, &pos, BAUD_SWITCH_CMD);
+    Convert::FB::writeU8(frame, &pos, op);
+    Convert::FB::writeU32(frame, &pos, baud);
+    m_output(static_cast<int>(pos), frame);
+}
+
+// initiator: peer accepted, switch and start CONFIRM at new baud
+void BaudSwitch::_accepted(uint32_t baud)
+{
+    _apply(baud);
+    m_state = STATE_WAIT_CONFIRM;
+    m_stateTime = m_clock();
+    m_retryTime = m_stateTime;
+    _send(BAUD_SWITCH_OP_CONFIRM, baud);
+}
+
+void BaudSwitch::_apply(uint32_t baud)
+{
+    if (baud == m_baud) {
+        return;
+    }
+
+    m_baud = baud;
+    m_stats.baud = baud;
+    if (m_onBaud) {
+        m_onBaud(baud);
+    }
+}
+
+void BaudSwitch::_finish(BaudSwitchResult result)
+{
+    m_state = STATE_IDLE;
+    m_rxTime = m_clock();
+    if (m_onResult) {
+        m_onResult(result, m_baud);
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef BAUD_SWITCH_H
+#define BAUD_SWITCH_H
+
+#include <stdint.h>
+#include <functional>
+
+/*
+ * UART baud rate change at runtime, negotiated with peer (platform independent).
+ * Same class on both ends, side that calls request() is initiator.
+ *
+ *  frame: {BAUD_SWITCH_CMD}{op}{baud >> 24}{baud >> 16}{baud >> 8}{baud}
+ *
+ *  initiator                              responder
+ *  REQUEST(baud)   --- old baud -->
+ *                  <-- old baud ---      ACK(baud) (or NAK), switches after ACK
+ *  switches
+ *  CONFIRM(baud)   --- new baud -->      (repeated every BAUD_SWITCH_RETRY_MS)
+ *                  <-- new baud ---      CONFIRM(baud), done
+ *  done
+ *
+ * Safe fallback: no ACK in ackTimeout -> initiator stays on old baud; no CONFIRM in
+ * confirmTimeout after switch -> side goes back to old baud (both sides do it), initiator
+ * first sends REVERT(old baud) at new baud: responder that already got CONFIRM (only its
+ * answers were lost) goes back too, so sides do not stay on different bauds.
+ * Both sides request at once: lower baud wins, same baud -> each REQUEST is ACK for other.
+ * Optional watchdog (setWatchdog()): no valid frame from peer for idleMs while baud is
+ * not default one -> back to default baud, covers link lost both ways after CONFIRM. Both
+ * ends must use it with same idleMs, one sided watchdog breaks quiet link by itself.
+ *
+ * onBaud() handler must finish pending TX before it changes baud (ACK must go out at old one).
+ */
+
+#define BAUD_SWITCH_CMD ((uint8_t)0xF6)
+#define BAUD_SWITCH_FRAME_SIZE 6
+
+#define BAUD_SWITCH_OP_REQUEST 1
+#define BAUD_SWITCH_OP_ACK 2
+#define BAUD_SWITCH_OP_NAK 3
+#define BAUD_SWITCH_OP_CONFIRM 4
+#define BAUD_SWITCH_OP_REVERT 5     // initiator gave up, back to this (old) baud
+
+#define BAUD_SWITCH_MIN 9600U
+#define BAUD_SWITCH_MAX 5000000U           // ESP32 UART limit
+
+#define BAUD_SWITCH_ACK_TIMEOUT_MS 100U
+#define BAUD_SWITCH_CONFIRM_TIMEOUT_MS 500U
+#define BAUD_SWITCH_RETRY_MS 20U
+
+enum BaudSwitchResult
+{
+    BAUD_SWITCH_OK = 0,
+    BAUD_SWITCH_BUSY,           // negotiation already runs
+    BAUD_SWITCH_UNSUPPORTED,    // out of range here or NAK from peer
+    BAUD_SWITCH_NO_ACK,         // peer did not answer at old baud
+    BAUD_SWITCH_NO_CONFIRM,     // new baud did not work (or peer sent REVERT), old one is back
+    BAUD_SWITCH_WATCHDOG        // link idle at non default baud, default one is back
+};
+
+struct BaudSwitchStats
+{
+    uint32_t requests = 0;      // requests started here
+    uint32_t switches = 0;      // successful changes (both roles)
+    uint32_t naks = 0;
+    uint32_t noAck = 0;
+    uint32_t noConfirm = 0;
+    uint32_t reverts = 0;       // REVERT from peer taken
+    uint32_t watchdog = 0;
+    uint32_t baud = 0;          // current
+};
+
+class BaudSwitch
+{
+public:
+    typedef uint32_t (*Clock)(void);
+    typedef std::function<void(int len, uint8_t* data)> Output;
+
+    BaudSwitch(Clock clock);
+
+    // frames to peer
+    void output(Output out);
+    // apply baud to uart
+    void onBaud(std::function<void(uint32_t baud)> foo);
+    // negotiation finished (both roles), baud - one in use now
+    void onResult(std::function<void(BaudSwitchResult result, uint32_t baud)> foo);
+
+    // baud uart runs now, it is also default for watchdog
+    void begin(uint32_t baud);
+    void setRange(uint32_t minBaud, uint32_t maxBaud);
+    void setTimeouts(uint32_t ackMs, uint32_t confirmMs);
+    // idleMs == 0 -> watchdog off
+    inline void setWatchdog(uint32_t idleMs) {m_watchdogMs = idleMs;}
+
+    // start negotiation as initiator, result goes to onResult()
+    BaudSwitchResult request(uint32_t baud);
+
+    // any frame from peer, returns false if it is not baud switch frame
+    bool input(int len, uint8_t* data);
+    // same, for command handlers (command byte already removed)
+    void frame(int len, uint8_t* data);
+
+    // timeouts, retries and watchdog
+    void proceed();
+
+    inline bool busy() const {return m_state != STATE_IDLE;}
+    inline uint32_t baud() const {return m_baud;}
+    inline const BaudSwitchStats& stats() const {return m_stats;}
+
+private:
+    enum State { STATE_IDLE, STATE_WAIT_ACK, STATE_WAIT_CONFIRM };
+
+    void _send(uint8_t op, uint32_t baud);
+    void _accepted(uint32_t baud);
+    void _apply(uint32_t baud);
+    void _finish(BaudSwitchResult result);
+    inline bool _supported(uint32_t baud) const {return baud >= m_minBaud && baud <= m_maxBaud;}
+
+    Clock m_clock;
+    Output m_output = nullptr;
+    std::function<void(uint32_t baud)> m_onBaud = nullptr;
+    std::function<void(BaudSwitchResult result, uint32_t baud)> m_onResult = nullptr;
+
+    State m_state = STATE_IDLE;
+    bool m_initiator = false;
+    bool m_collision = false;   // both sides requested same baud, both are initiators
+    uint32_t m_baud = 0;
+    uint32_t m_oldBaud = 0;
+    uint32_t m_newBaud = 0;
+    uint32_t m_defaultBaud = 0;
+    uint32_t m_stateTime = 0;
+    uint32_t m_retryTime = 0;
+    uint32_t m_rxTime = 0;      // last frame from peer
+
+    uint32_t m_minBaud = BAUD_SWITCH_MIN;
+    uint32_t m_maxBaud = BAUD_SWITCH_MAX;
+    uint32_t m_ackMs = BAUD_SWITCH_ACK_TIMEOUT_MS;
+    uint32_t m_confirmMs = BAUD_SWITCH_CONFIRM_TIMEOUT_MS;
+    uint32_t m_watchdogMs = 0;
+
+    BaudSwitchStats m_stats;
+};
+
+#endif /* BAUD_SWITCH_H */
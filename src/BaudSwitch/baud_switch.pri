@@ -0,0 +1,10 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD	
+
+SOURCES += \
+    $$PWD/baud_switch.cpp \
+    $$PWD/baud_switch_test.cpp
+
+HEADERS += \
+    $$PWD/baud_switch.h \
+    $$PWD/baud_switch_test.h
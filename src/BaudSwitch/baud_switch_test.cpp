@@ -0,0 +1,271 @@
+// TEST: g++ -O2 -Wall -Wextra -I../TestUtil -I../Convert -DBAUD_SWITCH_TEST_MAIN baud_switch.cpp baud_switch_test.cpp -o baud_switch_test && ./baud_switch_test
+#include "baud_switch_test.h"
+#include "baud_switch.h"
+#include "test_util.h"
+
+#include <stdio.h>
+#include <vector>
+
+// two uarts on one wire: frame gets through only if receiver runs at baud it was sent with
+struct Peer
+{
+    Peer() : link(fakeClock) {}
+
+    BaudSwitch link;
+    uint32_t uartBaud = 0;
+    int results = 0;
+    BaudSwitchResult result = BAUD_SWITCH_OK;
+    uint32_t resultBaud = 0;
+};
+
+struct Sent
+{
+    uint32_t baud;
+    std::vector<uint8_t> data;
+};
+
+struct Wire
+{
+    Wire(uint32_t baud)
+    {
+        connect(a, toB, baud);
+        connect(b, toA, baud);
+    }
+
+    void connect(Peer& peer, std::vector<Sent>& queue, uint32_t baud)
+    {
+        peer.uartBaud = baud;
+        peer.link.output([&peer, &queue](int len, uint8_t* data) {
+            queue.push_back({peer.uartBaud, std::vector<uint8_t>(data, data + len)});
+        });
+        peer.link.onBaud([&peer](uint32_t newBaud) {
+            peer.uartBaud = newBaud;
+        });
+        peer.link.onResult([&peer](BaudSwitchResult result, uint32_t resultBaud) {
+            ++peer.results;
+            peer.result = result;
+            peer.resultBaud = resultBaud;
+        });
+        peer.link.begin(baud);
+    }
+
+    void deliver(std::vector<Sent>& queue, Peer& to, bool drop)
+    {
+        std::vector<Sent> frames;
+        frames.swap(queue);
+        for (Sent& sent : frames) {
+            if (!drop && sent.baud == to.uartBaud) {
+                to.link.input(static_cast<int>(sent.data.size()), sent.data.data());
+            }
+        }
+    }
+
+    // runs both sides for ms, 1 ms steps
+    void run(uint32_t ms)
+    {
+        for (uint32_t i = 0; i < ms; ++i) {
+            deliver(toB, b, dropToB || (dropNew && b.uartBaud != base));
+            deliver(toA, a, dropToA || (dropNew && a.uartBaud != base));
+            a.link.proceed();
+            b.link.proceed();
+            ++fakeTime();
+        }
+    }
+
+    Peer a, b;
+    std::vector<Sent> toA, toB;
+    uint32_t base = 115200;
+    bool dropToA = false;
+    bool dropToB = false;
+    bool dropNew = false;   // new baud does not work (cable, level shifter...)
+};
+
+static void testSwitch()
+{
+    Wire wire(115200);
+    TEST_ASSERT("switch: request accepted", wire.a.link.request(2000000) == BAUD_SWITCH_OK);
+    TEST_ASSERT("switch: busy while running", wire.a.link.request(921600) == BAUD_SWITCH_BUSY);
+    wire.run(50);
+
+    TEST_ASSERT("switch: initiator on new baud", wire.a.uartBaud == 2000000 && wire.a.link.baud() == 2000000);
+    TEST_ASSERT("switch: responder on new baud", wire.b.uartBaud == 2000000 && wire.b.link.baud() == 2000000);
+    TEST_ASSERT("switch: initiator result", wire.a.results == 1 && wire.a.result == BAUD_SWITCH_OK);
+    TEST_ASSERT("switch: responder result", wire.b.results == 1 && wire.b.result == BAUD_SWITCH_OK);
+    TEST_ASSERT("switch: counters", wire.a.link.stats().switches == 1 && wire.b.link.stats().switches == 1
+                && wire.a.link.stats().requests == 1 && wire.b.link.stats().requests == 0);
+    TEST_ASSERT("switch: idle after", !wire.a.link.busy() && !wire.b.link.busy());
+
+    // and back, started from other side
+    TEST_ASSERT("switch back: request", wire.b.link.request(115200) == BAUD_SWITCH_OK);
+    wire.run(50);
+    TEST_ASSERT("switch back: both on old baud", wire.a.uartBaud == 115200 && wire.b.uartBaud == 115200);
+    TEST_ASSERT("switch back: result", wire.b.results == 2 && wire.b.result == BAUD_SWITCH_OK);
+}
+
+static void testRange()
+{
+    Wire wire(115200);
+    TEST_ASSERT("range: local limit", wire.a.link.request(6000000) == BAUD_SWITCH_UNSUPPORTED);
+    TEST_ASSERT("range: nothing sent", wire.toB.empty());
+
+    wire.b.link.setRange(9600, 1000000);
+    TEST_ASSERT("range: request", wire.a.link.request(3000000) == BAUD_SWITCH_OK);
+    wire.run(20);
+    TEST_ASSERT("range: NAK from peer", wire.a.results == 1 && wire.a.result == BAUD_SWITCH_UNSUPPORTED);
+    TEST_ASSERT("range: baud kept", wire.a.uartBaud == 115200 && wire.b.uartBaud == 115200);
+    TEST_ASSERT("range: nak counted", wire.a.link.stats().naks == 1 && wire.b.link.stats().naks == 1);
+}
+
+static void testNoAck()
+{
+    Wire wire(115200);
+    wire.dropToB = true;
+    wire.a.link.request(2000000);
+    wire.run(BAUD_SWITCH_ACK_TIMEOUT_MS / 2);
+    TEST_ASSERT("no ack: still waiting", wire.a.link.busy() && wire.a.results == 0);
+    wire.run(BAUD_SWITCH_ACK_TIMEOUT_MS);
+    TEST_ASSERT("no ack: timeout", wire.a.results == 1 && wire.a.result == BAUD_SWITCH_NO_ACK);
+    TEST_ASSERT("no ack: baud kept", wire.a.uartBaud == 115200 && wire.a.link.stats().noAck == 1);
+}
+
+static void testFallback()
+{
+    Wire wire(115200);
+    wire.dropNew = true;
+    wire.a.link.request(5000000);
+    wire.run(10);
+    TEST_ASSERT("fallback: both switched", wire.a.uartBaud == 5000000 && wire.b.uartBaud == 5000000);
+
+    wire.run(BAUD_SWITCH_CONFIRM_TIMEOUT_MS + 10);
+    TEST_ASSERT("fallback: initiator back", wire.a.uartBaud == 115200 && wire.a.result == BAUD_SWITCH_NO_CONFIRM);
+    TEST_ASSERT("fallback: responder back", wire.b.uartBaud == 115200 && wire.b.result == BAUD_SWITCH_NO_CONFIRM);
+    TEST_ASSERT("fallback: counted", wire.a.link.stats().noConfirm == 1 && wire.b.link.stats().noConfirm == 1);
+
+    // link works at old baud, next try succeeds
+    wire.dropNew = false;
+    wire.a.link.request(921600);
+    wire.run(20);
+    TEST_ASSERT("fallback: next request", wire.a.result == BAUD_SWITCH_OK && wire.b.uartBaud == 921600);
+}
+
+static void testWatchdog()
+{
+    Wire wire(115200);
+    wire.b.link.setWatchdog(1000);
+    wire.a.link.request(2000000);
+    wire.run(1);    // REQUEST and ACK went through
+    TEST_ASSERT("watchdog: both switched", wire.a.uartBaud == 2000000 && wire.b.uartBaud == 2000000);
+
+    // responder gets CONFIRM, then link is lost both ways: REVERT does not get through either
+    wire.dropToA = true;
+    wire.run(1);
+    wire.dropToB = true;
+    wire.run(BAUD_SWITCH_CONFIRM_TIMEOUT_MS + 10);
+    TEST_ASSERT("watchdog: sides disagree", wire.a.uartBaud == 115200 && wire.b.uartBaud == 2000000
+                && wire.b.result == BAUD_SWITCH_OK);
+
+    wire.dropToA = false;
+    wire.dropToB = false;
+    wire.run(1000);
+    TEST_ASSERT("watchdog: responder back on default", wire.b.uartBaud == 115200 && wire.b.result == BAUD_SWITCH_WATCHDOG);
+    TEST_ASSERT("watchdog: counted", wire.b.link.stats().watchdog == 1);
+
+    // traffic keeps new baud
+    wire.a.link.request(2000000);
+    wire.run(20);
+    const uint8_t data[] = {1, 2, 3};
+    for (int i = 0; i < 30; ++i) {
+        wire.b.link.input(sizeof(data), const_cast<uint8_t*>(data));
+        wire.run(100);
+    }
+    TEST_ASSERT("watchdog: traffic keeps baud", wire.b.uartBaud == 2000000 && wire.b.link.stats().watchdog == 1);
+}
+
+static void testRevert()
+{
+    Wire wire(115200);
+    wire.a.link.request(2000000);
+    wire.run(1);
+
+    // every CONFIRM answer is lost: responder is done, initiator gives up and sends REVERT
+    wire.dropToA = true;
+    wire.run(BAUD_SWITCH_CONFIRM_TIMEOUT_MS + 10);
+    TEST_ASSERT("revert: initiator back", wire.a.uartBaud == 115200 && wire.a.result == BAUD_SWITCH_NO_CONFIRM);
+    TEST_ASSERT("revert: responder follows", wire.b.uartBaud == 115200 && wire.b.result == BAUD_SWITCH_NO_CONFIRM
+                && wire.b.results == 2 && wire.b.link.stats().reverts == 1);
+
+    // stale REVERT changes nothing
+    uint8_t revert[] = {BAUD_SWITCH_CMD, BAUD_SWITCH_OP_REVERT, 0x00, 0x01, 0xC2, 0x00};
+    wire.b.link.input(sizeof(revert), revert);
+    TEST_ASSERT("revert: stale ignored", wire.b.uartBaud == 115200 && wire.b.link.stats().reverts == 1);
+
+    wire.dropToA = false;
+    wire.a.link.request(921600);
+    wire.run(20);
+    TEST_ASSERT("revert: next request", wire.a.result == BAUD_SWITCH_OK && wire.b.uartBaud == 921600);
+}
+
+static void testCollision()
+{
+    Wire wire(115200);
+    wire.a.link.request(2000000);
+    wire.b.link.request(921600);
+    wire.run(50);
+    TEST_ASSERT("collision: lower baud wins", wire.a.uartBaud == 921600 && wire.b.uartBaud == 921600);
+    TEST_ASSERT("collision: both done", wire.a.result == BAUD_SWITCH_OK && wire.b.result == BAUD_SWITCH_OK
+                && !wire.a.link.busy() && !wire.b.link.busy());
+}
+
+static void testCollisionSameBaud()
+{
+    Wire wire(115200);
+    wire.a.link.request(2000000);
+    wire.b.link.request(2000000);
+    wire.run(50);
+    TEST_ASSERT("same baud collision: both switched", wire.a.uartBaud == 2000000 && wire.b.uartBaud == 2000000);
+    TEST_ASSERT("same baud collision: both done", wire.a.result == BAUD_SWITCH_OK && wire.b.result == BAUD_SWITCH_OK
+                && !wire.a.link.busy() && !wire.b.link.busy());
+    TEST_ASSERT("same baud collision: one result each", wire.a.results == 1 && wire.b.results == 1);
+
+    // CONFIRM exchange ended, nothing is ping-ponged
+    wire.run(BAUD_SWITCH_CONFIRM_TIMEOUT_MS);
+    TEST_ASSERT("same baud collision: link quiet", wire.toA.empty() && wire.toB.empty()
+                && wire.a.uartBaud == 2000000 && wire.b.uartBaud == 2000000);
+}
+
+static void testForeignFrames()
+{
+    Wire wire(115200);
+    uint8_t data[] = {0x01, 0x02};
+    TEST_ASSERT("foreign: not consumed", !wire.a.link.input(sizeof(data), data));
+    uint8_t shortFrame[] = {BAUD_SWITCH_CMD, BAUD_SWITCH_OP_REQUEST};
+    TEST_ASSERT("foreign: short consumed", wire.a.link.input(sizeof(shortFrame), shortFrame));
+    wire.run(5);
+    TEST_ASSERT("foreign: short ignored", wire.toB.empty() && !wire.a.link.busy() && wire.a.uartBaud == 115200);
+}
+
+int baudSwitchTest(void)
+{
+    failCount = 0;
+    testSwitch();
+    testRange();
+    testNoAck();
+    testFallback();
+    testRevert();
+    testWatchdog();
+    testCollision();
+    testCollisionSameBaud();
+    testForeignFrames();
+
+    if (failCount == 0) {
+        printf("baud switch: all tests passed\n");
+    }
+    return failCount;
+}
+
+#ifdef BAUD_SWITCH_TEST_MAIN
+int main(void)
+{
+    return baudSwitchTest() ? 1 : 0;
+}
+#endif /* BAUD_SWITCH_TEST_MAIN */
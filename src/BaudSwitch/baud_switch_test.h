@@ -0,0 +1,7 @@
+#ifndef BAUD_SWITCH_TEST_H
+#define BAUD_SWITCH_TEST_H
+
+// returns count of failed checks
+int baudSwitchTest(void);
+
+#endif /* BAUD_SWITCH_TEST_H */
@@ -0,0 +1,86 @@
+#include "FlashLog.hpp"
+#include <LittleFS.h>
+
+
+bool FlashLog::begin(const char* path, uint32_t maxSize)
+{
+    m_path = path;
+    m_maxSize = maxSize;
+
+    if (!LittleFS.begin(true)) {
+        return false;
+    }
+
+    LittleFS.remove(m_path);
+    return _open();
+}
+
+bool FlashLog::_open()
+{
+    // a+ : reads anywhere after seek, writes always go to end
+    m_file = LittleFS.open(m_path, "a+");
+    m_readPos = 0;
+    m_writePos = 0;
+    return static_cast<bool>(m_file);
+}
+
+bool FlashLog::fits(uint32_t len) const
+{
+    return m_file && (m_writePos + FLASH_LOG_HEADER + len) <= m_maxSize;
+}
+
+bool FlashLog::append(const uint8_t* data, uint32_t len)
+{
+    if (!fits(len) || len > 0xFFFF) {
+        return false;
+    }
+
+    const uint8_t header[FLASH_LOG_HEADER] = {static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len)};
+    m_file.seek(0, SeekEnd);
+    if (m_file.write(header, FLASH_LOG_HEADER) != FLASH_LOG_HEADER || m_file.write(data, len) != len) {
+        // partly written entry would break all next ones
+        ++m_writeErrors;
+        clear();
+        return false;
+    }
+
+    m_writePos += FLASH_LOG_HEADER + len;
+    return true;
+}
+
+int FlashLog::read(uint8_t* out, uint32_t size)
+{
+    if (m_readPos >= m_writePos) {
+        return -1;
+    }
+
+    m_file.flush();
+    m_file.seek(m_readPos, SeekSet);
+
+    uint8_t header[FLASH_LOG_HEADER];
+    if (m_file.read(header, FLASH_LOG_HEADER) != FLASH_LOG_HEADER) {
+        clear();
+        return -1;
+    }
+
+    const uint32_t len = (static_cast<uint32_t>(header[0]) << 8) | header[1];
+    if (len > size || (m_readPos + FLASH_LOG_HEADER + len) > m_writePos || m_file.read(out, len) != len) {
+        clear(); // log is broken, nothing after this entry can be trusted
+        return -1;
+    }
+
+    m_readPos += FLASH_LOG_HEADER + len;
+    if (m_readPos == m_writePos) {
+        clear();
+    }
+    return static_cast<int>(len);
+}
+
+void FlashLog::clear()
+{
+    if (m_file) {
+        m_file.close();
+    }
+    LittleFS.remove(m_path);
+    _open();
+}
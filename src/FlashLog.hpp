@@ -0,0 +1,49 @@
+#ifndef FLASH_LOG
+#define FLASH_LOG
+
+#include <FS.h>
+#include "store_forward.h"
+
+/*
+ * Store-and-forward log on LittleFS partition: append-only file of {len >> 8}{len & 0xFF}{entry}.
+ * Entries are read from m_readPos, file is removed when everything is read, so space
+ * comes back only after full replay. Old file is removed on begin(): entry times
+ * are millis() of previous boot.
+ */
+
+#ifndef FLASH_LOG_PATH
+#   define FLASH_LOG_PATH "/store.log"
+#endif /* FLASH_LOG_PATH */
+
+#ifndef FLASH_LOG_MAX_SIZE
+#   define FLASH_LOG_MAX_SIZE (512U * 1024U)
+#endif /* FLASH_LOG_MAX_SIZE */
+
+#define FLASH_LOG_HEADER 2
+
+class FlashLog : public StoreForwardLog
+{
+public:
+    // mounts LittleFS (formats it if mount fails), returns false if file can not be opened
+    bool begin(const char* path = FLASH_LOG_PATH, uint32_t maxSize = FLASH_LOG_MAX_SIZE);
+
+    bool fits(uint32_t len) const override;
+    bool append(const uint8_t* data, uint32_t len) override;
+    int read(uint8_t* out, uint32_t size) override;
+    inline uint32_t used() const override {return m_writePos - m_readPos;}
+    void clear() override;
+
+    inline uint32_t writeErrors() const {return m_writeErrors;}
+
+private:
+    bool _open();
+
+    const char* m_path = FLASH_LOG_PATH;
+    uint32_t m_maxSize = FLASH_LOG_MAX_SIZE;
+    File m_file;
+    uint32_t m_readPos = 0;
+    uint32_t m_writePos = 0;
+    uint32_t m_writeErrors = 0;
+};
+
+#endif /* FLASH_LOG */
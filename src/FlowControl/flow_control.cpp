@@ -0,0 +1,203 @@
+#include "flow_control.h"
+
+
+FlowControl::FlowControl(Clock clock) :
+    m_clock(clock)
+{
+
+}
+
+void FlowControl::output(Output out)
+{
+    m_output = out;
+}
+
+void FlowControl::upstream(Output out, uint16_t window)
+{
+    m_upstream = out;
+    m_window = window;
+}
+
+void FlowControl::setPolicy(FlowPolicy policy, uint32_t blockTimeoutMs)
+{
+    m_policy = policy;
+    m_blockTimeoutMs = blockTimeoutMs;
+}
+
+void FlowControl::setBlockPoll(std::function<void()> poll)
+{
+    m_blockPoll = poll;
+}
+
+
+// frames -----------------------------------------------------------------------------
+bool FlowControl::write(int len, uint8_t* data)
+{
+    if (len < 0 || static_cast<uint32_t>(len) > sizeof(m_frame)) {
+        ++m_stats.droppedNewest;
+        _consume(1);
+        return false;
+    }
+
+    // older frames go first
+    proceed();
+
+    if (m_queue.empty() && _hasCredit()) {
+        _send(len, data);
+        return true;
+    }
+
+    ++m_stats.queued;
+    return _enqueue(len, data);
+}
+
+bool FlowControl::_enqueue(int len, uint8_t* data)
+{
+    bool pushed = false;
+
+    switch (m_policy) {
+    case FLOW_DROP_OLDEST: {
+        uint32_t dropped = 0;
+        pushed = m_queue.pushOverwrite(data, len, &dropped);
+        m_stats.droppedOldest += dropped;
+        _consume(dropped);
+        break;
+    }
+
+    case FLOW_BLOCK: {
+        const uint32_t start = m_clock();
+        while (!(pushed = m_queue.push(data, len))) {
+            if ((m_clock() - start) >= m_blockTimeoutMs) {
+                ++m_stats.blockTimeouts;
+                break;
+            }
+            if (m_blockPoll) {
+                m_blockPoll(); // credit frames come in here
+            }
+            proceed();
+        }
+        m_stats.blockedMs += m_clock() - start;
+        break;
+    }
+
+    default:
+        pushed = m_queue.push(data, len);
+        break;
+    }
+
+    if (!pushed) {
+        if (m_policy != FLOW_BLOCK) {
+            ++m_stats.droppedNewest;
+        }
+        _consume(1);
+    }
+
+    if (m_queue.highWater() > m_stats.queueHighWater) {
+        m_stats.queueHighWater = m_queue.highWater();
+    }
+    return pushed;
+}
+
+void FlowControl::proceed()
+{
+    int len;
+    while (_hasCredit() && (len = m_queue.pop(m_frame, sizeof(m_frame))) >= 0) {
+        _send(len, m_frame);
+    }
+}
+
+void FlowControl::_send(int len, uint8_t* data)
+{
+    if (m_stats.credits > 0) {
+        --m_stats.credits;
+    }
+    ++m_stats.sent;
+
+    if (m_output) {
+        m_output(len, data);
+    }
+    _consume(1);
+}
+
+// give source back credit for frames which left this queue (sent or dropped),
+// otherwise drops eat source credit and it stops for good
+void FlowControl::_consume(uint32_t frames)
+{
+    if (!m_upstream || !m_window || !frames) {
+        return;
+    }
+
+    m_consumed = static_cast<uint16_t>(m_consumed + (frames > 0xFFFF ? 0xFFFF : frames));
+    if (m_consumed >= ((m_window + 1) / 2)) {
+        _grant(0, m_consumed);
+        m_consumed = 0;
+    }
+}
+
+
+// credits ----------------------------------------------------------------------------
+bool FlowControl::input(int len, uint8_t* data)
+{
+    if (len < 1 || data[0] != FLOW_CONTROL_CMD_CREDIT) {
+        return false;
+    }
+    creditFrame(len - 1, data + 1);
+    return true;
+}
+
+void FlowControl::creditFrame(int len, uint8_t* data)
+{
+    if (len < (FLOW_CONTROL_CREDIT_SIZE - 1)) {
+        return;
+    }
+
+    const int32_t credits = (data[1] << 8) | data[2];
+    ++m_stats.creditFrames;
+
+    if ((data[0] & FLOW_CONTROL_CREDIT_RESET) || m_stats.credits < 0) {
+        m_stats.credits = credits;
+    } else {
+        m_stats.credits += credits;
+        if (m_stats.credits > 0xFFFF) {
+            m_stats.credits = 0xFFFF;
+        }
+    }
+
+    proceed();
+}
+
+void FlowControl::resetPeer()
+{
+    m_stats.credits = -1;
+    proceed();
+}
+
+void FlowControl::advertise()
+{
+    if (!m_upstream || !m_window) {
+        return;
+    }
+
+    // frames already waiting here take part of window
+    uint32_t free = m_queue.capacity() - m_queue.used();
+    uint16_t credits = m_window;
+    if (free < m_queue.capacity() / 2) {
+        credits = static_cast<uint16_t>((static_cast<uint32_t>(m_window) * free) / m_queue.capacity());
+    }
+
+    m_consumed = 0;
+    _grant(FLOW_CONTROL_CREDIT_RESET, credits);
+}
+
+void FlowControl::_grant(uint8_t flags, uint16_t credits)
+{
+    uint8_t frame[FLOW_CONTROL_CREDIT_SIZE] = {
+        FLOW_CONTROL_CMD_CREDIT,
+        flags,
+        static_cast<uint8_t>(credits >> 8),
+        static_cast<uint8_t>(credits)
+    };
+
+    ++m_stats.grantFrames;
+    m_upstream(sizeof(frame), frame);
+}
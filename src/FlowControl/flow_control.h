@@ -0,0 +1,130 @@
+#ifndef FLOW_CONTROL_H
+#define FLOW_CONTROL_H
+
+#include <stdint.h>
+#include <functional>
+#include "frame_codec.h"
+#include "spsc_ring.h"
+
+/*
+ * Credit based flow control for one direction of bridge (platform independent).
+ *
+ *  source --frames--> [FlowControl queue] --frames--> peer
+ *  source <--credit--                     <--credit-- peer
+ *
+ * Peer tells how many frames it can take with credit frame:
+ *      {FLOW_CONTROL_CMD_CREDIT}{flags}{credits >> 8}{credits & 0xFF}
+ *  flags & FLOW_CONTROL_CREDIT_RESET -> credits is absolute (sent on (re)connect),
+ *  otherwise credits are added (frames peer consumed since last credit frame).
+ *
+ * Until first credit frame arrives credits are unlimited (peer without flow control).
+ * Frames without credit wait in queue, when queue is full policy decides:
+ *  FLOW_DROP_NEWEST - new frame is dropped
+ *  FLOW_DROP_OLDEST - oldest queued frames are dropped
+ *  FLOW_BLOCK       - write() polls transport (setBlockPoll()) until frame fits or
+ *                     block timeout passed, then new frame is dropped
+ *
+ * Same object grants credits to source (upstream()): window frames on advertise(),
+ * then every window / 2 frames which left queue (passed to peer or dropped, source spent
+ * its credit on both). Window must not be above FLOW_CONTROL_MAX_WINDOW: queue has to
+ * hold every frame source may send ahead. All counters are in FlowControlStats.
+ */
+
+#define FLOW_CONTROL_CMD_CREDIT ((uint8_t)0xF2)
+#define FLOW_CONTROL_CREDIT_RESET 0x01
+#define FLOW_CONTROL_CREDIT_SIZE 4
+
+// queued bytes (power of two), every frame takes 2 bytes + payload
+#ifndef FLOW_CONTROL_QUEUE_SIZE
+#   define FLOW_CONTROL_QUEUE_SIZE 4096U
+#endif /* FLOW_CONTROL_QUEUE_SIZE */
+
+#define FLOW_CONTROL_BLOCK_TIMEOUT_MS 20U
+
+// frames of max size queue holds
+#define FLOW_CONTROL_MAX_WINDOW (FLOW_CONTROL_QUEUE_SIZE / (FRAME_CODEC_MAX_PAYLOAD + SpscFrameRing<FLOW_CONTROL_QUEUE_SIZE>::header))
+
+static_assert(FRAME_CODEC_MAX_PAYLOAD <= SpscFrameRing<FLOW_CONTROL_QUEUE_SIZE>::maxFrame, "FLOW_CONTROL_QUEUE_SIZE too small for one frame");
+
+enum FlowPolicy
+{
+    FLOW_DROP_NEWEST = 0,
+    FLOW_DROP_OLDEST,
+    FLOW_BLOCK
+};
+
+struct FlowControlStats
+{
+    uint32_t sent = 0;          // frames passed to peer
+    uint32_t queued = 0;        // frames which had to wait for credit
+    uint32_t droppedNewest = 0;
+    uint32_t droppedOldest = 0;
+    uint32_t blockTimeouts = 0; // FLOW_BLOCK gave up, frame dropped
+    uint32_t blockedMs = 0;     // total time spent in FLOW_BLOCK waits
+    uint32_t creditFrames = 0;  // credit frames from peer
+    uint32_t grantFrames = 0;   // credit frames to source
+    int32_t credits = -1;       // frames peer can take now, -1 -> unlimited
+    uint32_t queueHighWater = 0; // bytes
+};
+
+class FlowControl
+{
+public:
+    typedef uint32_t (*Clock)(void);
+    typedef std::function<void(int len, uint8_t* data)> Output;
+
+    FlowControl(Clock clock);
+
+    // frames to peer
+    void output(Output out);
+    // credit frames to source, window - frames source may send ahead (<= FLOW_CONTROL_MAX_WINDOW)
+    void upstream(Output out, uint16_t window);
+
+    void setPolicy(FlowPolicy policy, uint32_t blockTimeoutMs = FLOW_CONTROL_BLOCK_TIMEOUT_MS);
+    void setBlockPoll(std::function<void()> poll);
+
+    // returns false if frame was dropped
+    bool write(int len, uint8_t* data);
+    // send queued frames while there is credit
+    void proceed();
+
+    // credit frame from peer, returns false if it is not credit frame
+    bool input(int len, uint8_t* data);
+    // same, for command table handlers (command byte already removed)
+    void creditFrame(int len, uint8_t* data);
+
+    // peer (re)connected: credits unlimited until its first credit frame
+    void resetPeer();
+    // tell source how many frames it may send now (call on source (re)connect)
+    void advertise();
+
+    inline const FlowControlStats& stats() const {return m_stats;}
+    inline uint32_t queuedBytes() const {return m_queue.used();}
+
+private:
+    typedef SpscFrameRing<FLOW_CONTROL_QUEUE_SIZE> Queue;
+
+    inline bool _hasCredit() const {return m_stats.credits != 0;}
+    void _send(int len, uint8_t* data);
+    bool _enqueue(int len, uint8_t* data);
+    void _consume(uint32_t frames);
+    void _grant(uint8_t flags, uint16_t credits);
+
+    Clock m_clock;
+    Output m_output = nullptr;
+    Output m_upstream = nullptr;
+    std::function<void()> m_blockPoll = nullptr;
+
+    FlowPolicy m_policy = FLOW_DROP_NEWEST;
+    uint32_t m_blockTimeoutMs = FLOW_CONTROL_BLOCK_TIMEOUT_MS;
+
+    uint16_t m_window = 0;
+    uint16_t m_consumed = 0;     // frames which left queue since last grant to source
+
+    Queue m_queue;
+    uint8_t m_frame[FRAME_CODEC_MAX_PAYLOAD];
+
+    FlowControlStats m_stats;
+};
+
+#endif /* FLOW_CONTROL_H */
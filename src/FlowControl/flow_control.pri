@@ -0,0 +1,10 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD	
+
+SOURCES += \
+    $$PWD/flow_control.cpp \
+    $$PWD/flow_control_test.cpp
+
+HEADERS += \
+    $$PWD/flow_control.h \
+    $$PWD/flow_control_test.h
@@ -0,0 +1,223 @@
+// TEST: g++ -O2 -Wall -Wextra -I../TestUtil -I../FrameCodec -I../SpscRing -DFLOW_CONTROL_TEST_MAIN flow_control.cpp flow_control_test.cpp -o flow_control_test && ./flow_control_test
+#include "flow_control_test.h"
+#include "flow_control.h"
+#include "test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// flow control with recorded peer and source sides
+struct Line
+{
+    FlowControl flow{fakeClock};
+    std::vector<int> peer;              // ids of frames passed to peer
+    std::vector<std::vector<uint8_t> > grants;  // credit frames to source
+
+    Line(FlowPolicy policy, uint16_t window = 0)
+    {
+        flow.setPolicy(policy);
+        flow.output([this](int len, uint8_t* data) {
+            if (len >= 1) {
+                peer.push_back(data[0]);
+            }
+        });
+        if (window) {
+            flow.upstream([this](int len, uint8_t* data) {
+                grants.push_back(std::vector<uint8_t>(data, data + len));
+            }, window);
+        }
+    }
+
+    bool write(uint8_t id, int len = 100)
+    {
+        uint8_t frame[FRAME_CODEC_MAX_PAYLOAD];
+        memset(frame, id, len);
+        return flow.write(len, frame);
+    }
+
+    void credit(uint16_t credits, bool reset = false)
+    {
+        uint8_t frame[FLOW_CONTROL_CREDIT_SIZE] = {FLOW_CONTROL_CMD_CREDIT, static_cast<uint8_t>(reset ? FLOW_CONTROL_CREDIT_RESET : 0),
+                                                   static_cast<uint8_t>(credits >> 8), static_cast<uint8_t>(credits)};
+        flow.input(sizeof(frame), frame);
+    }
+};
+
+static uint16_t grantCredits(const std::vector<uint8_t>& frame)
+{
+    return static_cast<uint16_t>((frame[2] << 8) | frame[3]);
+}
+
+static void testUnlimited(void)
+{
+    Line line(FLOW_DROP_NEWEST);
+    for (int i = 0; i < 100; ++i) {
+        line.write(static_cast<uint8_t>(i));
+    }
+    TEST_ASSERT("no credit frame: unlimited", line.peer.size() == 100 && line.flow.stats().credits == -1);
+    TEST_ASSERT("no credit frame: nothing queued", line.flow.stats().queued == 0);
+}
+
+static void testCredits(void)
+{
+    Line line(FLOW_DROP_NEWEST);
+    line.credit(3, true);
+    for (int i = 0; i < 5; ++i) {
+        line.write(static_cast<uint8_t>(i));
+    }
+    TEST_ASSERT("credits: only credited frames sent", line.peer.size() == 3 && line.flow.stats().credits == 0);
+    TEST_ASSERT("credits: rest queued", line.flow.stats().queued == 2);
+
+    line.credit(1);
+    TEST_ASSERT("credits: grant sends queued frame", line.peer.size() == 4 && line.peer[3] == 3);
+    line.credit(10);
+    TEST_ASSERT("credits: order kept", line.peer.size() == 5 && line.peer[4] == 4 && line.flow.stats().credits == 9);
+
+    line.credit(2, true);
+    TEST_ASSERT("credits: reset is absolute", line.flow.stats().credits == 2);
+
+    line.flow.resetPeer();
+    TEST_ASSERT("credits: reset peer -> unlimited", line.flow.stats().credits == -1);
+}
+
+static void testDropNewest(void)
+{
+    Line line(FLOW_DROP_NEWEST);
+    line.credit(0, true);
+    int accepted = 0;
+    for (int i = 0; i < 100; ++i) {
+        accepted += line.write(static_cast<uint8_t>(i));
+    }
+    const uint32_t perFrame = 2 + 100;
+    TEST_ASSERT("drop newest: queue holds what fits", accepted == static_cast<int>(FLOW_CONTROL_QUEUE_SIZE / perFrame));
+    TEST_ASSERT("drop newest: rest counted", line.flow.stats().droppedNewest == static_cast<uint32_t>(100 - accepted));
+
+    line.credit(1000);
+    TEST_ASSERT("drop newest: oldest frames survive", line.peer.size() == static_cast<size_t>(accepted) && line.peer[0] == 0);
+}
+
+static void testDropOldest(void)
+{
+    Line line(FLOW_DROP_OLDEST);
+    line.credit(0, true);
+    for (int i = 0; i < 100; ++i) {
+        TEST_ASSERT("drop oldest: write accepted", line.write(static_cast<uint8_t>(i)));
+    }
+    line.credit(1000);
+
+    const size_t kept = FLOW_CONTROL_QUEUE_SIZE / (2 + 100);
+    TEST_ASSERT("drop oldest: newest frames survive", line.peer.size() == kept && line.peer.back() == 99 && line.peer[0] == static_cast<int>(100 - kept));
+    TEST_ASSERT("drop oldest: counted", line.flow.stats().droppedOldest == 100 - kept);
+}
+
+static void testBlock(void)
+{
+    Line line(FLOW_BLOCK);
+    line.credit(0, true);
+    while (line.flow.queuedBytes() + 102 <= FLOW_CONTROL_QUEUE_SIZE) {
+        line.write(1);
+    }
+
+    // poll hook is transport, credit comes after 5 ms of waiting
+    int polls = 0;
+    line.flow.setBlockPoll([&]() {
+        ++fakeTime();
+        if (++polls == 5) {
+            line.credit(1);
+        }
+    });
+    TEST_ASSERT("block: waits for credit", line.write(2) && polls == 5 && line.flow.stats().blockTimeouts == 0);
+    TEST_ASSERT("block: wait time counted", line.flow.stats().blockedMs == 5);
+
+    // no credit at all -> timeout drops frame
+    line.flow.setBlockPoll([&]() { ++fakeTime(); });
+    TEST_ASSERT("block: timeout drops", !line.write(3) && line.flow.stats().blockTimeouts == 1);
+}
+
+static void testUpstream(void)
+{
+    Line line(FLOW_DROP_NEWEST, 8);
+    line.flow.advertise();
+    TEST_ASSERT("upstream: advertise sends window", line.grants.size() == 1 && line.grants[0][1] == FLOW_CONTROL_CREDIT_RESET && grantCredits(line.grants[0]) == 8);
+
+    for (int i = 0; i < 8; ++i) {
+        line.write(static_cast<uint8_t>(i));
+    }
+    TEST_ASSERT("upstream: credit every half window", line.grants.size() == 3 && grantCredits(line.grants[1]) == 4 && line.grants[1][1] == 0);
+
+    // stuck peer: no credit goes back to source
+    line.credit(0, true);
+    for (int i = 0; i < 8; ++i) {
+        line.write(static_cast<uint8_t>(i));
+    }
+    TEST_ASSERT("upstream: no credit while peer is stuck", line.grants.size() == 3);
+    line.credit(8);
+    TEST_ASSERT("upstream: credit after peer drained", line.grants.size() == 5);
+}
+
+static void testUpstreamOverflow(void)
+{
+    const uint16_t window = FLOW_CONTROL_MAX_WINDOW * 4;
+    const int len = FRAME_CODEC_MAX_PAYLOAD - 24;
+
+    // source spends all its credit on big frames while peer has none: queue overflows,
+    // dropped frames must come back as credit or source stops for good
+    for (int policy = FLOW_DROP_NEWEST; policy <= FLOW_BLOCK; ++policy) {
+        Line line(static_cast<FlowPolicy>(policy), window);
+        line.flow.setBlockPoll([]() { ++fakeTime(); });
+        line.credit(0, true);
+        line.flow.advertise();
+
+        uint32_t written = 0;
+        bool stalled = false;
+        for (int round = 0; round < 5 && !stalled; ++round) {
+            uint32_t granted = 0;
+            for (size_t i = 0; i < line.grants.size(); ++i) {
+                granted += grantCredits(line.grants[i]);
+            }
+            stalled = granted == written;
+            for (; written < granted; ++written) {
+                line.write(static_cast<uint8_t>(written), len);
+            }
+            // peer takes queued frames, then stops again
+            line.credit(1000);
+            line.credit(0, true);
+        }
+        TEST_ASSERT("upstream overflow: grants keep coming", !stalled && written >= window * 4U);
+    }
+}
+
+static void testNotCredit(void)
+{
+    Line line(FLOW_DROP_NEWEST);
+    uint8_t frame[] = {0x01, 0x02};
+    TEST_ASSERT("other frame is not taken", !line.flow.input(sizeof(frame), frame));
+}
+
+
+int flowControlTest(void)
+{
+    failCount = 0;
+    testUnlimited();
+    testCredits();
+    testDropNewest();
+    testDropOldest();
+    testBlock();
+    testUpstream();
+    testUpstreamOverflow();
+    testNotCredit();
+
+    if (failCount == 0) {
+        printf("flow control: all tests passed\n");
+    }
+    return failCount;
+}
+
+
+#ifdef FLOW_CONTROL_TEST_MAIN
+int main(void)
+{
+    return flowControlTest() ? 1 : 0;
+}
+#endif /* FLOW_CONTROL_TEST_MAIN */
@@ -0,0 +1,7 @@
+#ifndef FLOW_CONTROL_TEST_H
+#define FLOW_CONTROL_TEST_H
+
+// returns count of failed checks
+int flowControlTest(void);
+
+#endif /* FLOW_CONTROL_TEST_H */
@@ -0,0 +1,67 @@
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <stdint.h>
+
+/*
+ * Command dispatch for received frames: data[0] is command id, rest is payload.
+ * Direct indexed, statically allocated table of 256 non-allocating handlers
+ * (function pointer + context), one load and one indirect call per frame.
+ */
+
+class CommandHandler
+{
+public:
+    typedef void (*Foo)(int len, uint8_t* data);
+    typedef void (*CtxFoo)(void* ctx, int len, uint8_t* data);
+
+    CommandHandler() {}
+    CommandHandler(Foo foo) : m_foo(foo ? _plain : nullptr), m_ctx(reinterpret_cast<void*>(foo)) {}
+    CommandHandler(CtxFoo foo, void* ctx) : m_foo(foo), m_ctx(ctx) {}
+
+    // handler = object method: CommandHandler::bind<Kuart, &Kuart::write>(&kuart)
+    template <class T, void (T::*Method)(int, uint8_t*)>
+    static CommandHandler bind(T* obj) { return CommandHandler(_method<T, Method>, obj); }
+
+    inline void operator()(int len, uint8_t* data) const { m_foo(m_ctx, len, data); }
+    inline explicit operator bool() const { return m_foo != nullptr; }
+
+private:
+    static void _plain(void* ctx, int len, uint8_t* data) { reinterpret_cast<Foo>(ctx)(len, data); }
+
+    template <class T, void (T::*Method)(int, uint8_t*)>
+    static void _method(void* ctx, int len, uint8_t* data) { (static_cast<T*>(ctx)->*Method)(len, data); }
+
+    CtxFoo m_foo = nullptr;
+    void* m_ctx = nullptr;
+};
+
+
+class CommandTable
+{
+public:
+    inline void on(uint8_t cmd, CommandHandler handler) { m_handlers[cmd] = handler; }
+    inline void off(uint8_t cmd) { m_handlers[cmd] = CommandHandler(); }
+    inline bool has(uint8_t cmd) const { return static_cast<bool>(m_handlers[cmd]); }
+
+    // frame = {cmd}{payload}, returns false if frame is empty or command is not registered
+    inline bool dispatch(int len, uint8_t* data) const
+    {
+        if (len <= 0) {
+            return false;
+        }
+
+        const CommandHandler& handler = m_handlers[data[0]];
+        if (!handler) {
+            return false;
+        }
+
+        handler(len - 1, data + 1);
+        return true;
+    }
+
+private:
+    CommandHandler m_handlers[256];
+};
+
+#endif /* COMMAND_TABLE_H */
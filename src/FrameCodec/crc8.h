@@ -0,0 +1,45 @@
+#ifndef CRC8_H
+#define CRC8_H
+
+#include <stdint.h>
+
+/*
+ * CRC-8, poly 0x31 (x^8 + x^5 + x^4 + 1), init 0xFF, no reflection, no final xor
+ *
+ *  bitwise - reference implementation, 8 shifts with branch per byte
+ *  table   - one 256 byte table lookup per byte
+ *  slice4  - four 256 byte tables, 4 bytes per step (CRC8_SLICE_BY_4 != 0)
+ */
+
+#ifndef CRC8_SLICE_BY_4
+#   define CRC8_SLICE_BY_4 1
+#endif /* CRC8_SLICE_BY_4 */
+
+#define CRC8_INIT ((uint8_t)0xFF)
+
+#if CRC8_SLICE_BY_4
+#   define CRC8_TABLES 4
+#else
+#   define CRC8_TABLES 1
+#endif /* CRC8_SLICE_BY_4 */
+
+class Crc8
+{
+public:
+    // single byte step
+    static inline uint8_t proceed(uint8_t crc, uint8_t ch) { return table[0][crc ^ ch]; }
+    static uint8_t proceedBitwise(uint8_t crc, uint8_t ch);
+
+    // bulk, continue from crc (use CRC8_INIT for new calculation)
+    static uint8_t crc(const uint8_t* buf, int len, uint8_t crc = CRC8_INIT);
+    static uint8_t crcTable(const uint8_t* buf, int len, uint8_t crc = CRC8_INIT);
+    static uint8_t crcBitwise(const uint8_t* buf, int len, uint8_t crc = CRC8_INIT);
+#if CRC8_SLICE_BY_4
+    static uint8_t crcSlice4(const uint8_t* buf, int len, uint8_t crc = CRC8_INIT);
+#endif /* CRC8_SLICE_BY_4 */
+
+    // table[k][i] - crc of byte i followed by k zero bytes
+    static const uint8_t table[CRC8_TABLES][256];
+};
+
+#endif /* CRC8_H */
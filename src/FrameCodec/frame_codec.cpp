@@ -0,0 +1,314 @@
+#include "frame_codec.h"
+#include <string.h>
+
+
+// encoder ------------------------------------------------------------------------
+int FrameEncoder::encode(int len, const uint8_t* data, uint8_t* out)
+{
+    return _encode(len, data, out, FRAME_CODEC_ENCODED_SIZE(len), nullptr);
+}
+
+int FrameEncoder::encode(int len, const uint8_t* data, uint8_t* chunk, int chunkSize, const Sink& sink)
+{
+    if (chunkSize < FRAME_CODEC_MIN_CHUNK) {
+        return -1;
+    }
+    return _encode(len, data, chunk, chunkSize, &sink);
+}
+
+int FrameEncoder::encodedSize(int len, const uint8_t* data)
+{
+    if (len < 0 || len > FRAME_CODEC_MAX_PAYLOAD) {
+        return -1;
+    }
+
+    const uint8_t startByte = FRAME_CODEC_START_BYTE;
+    int size = 1;
+    uint8_t crc;
+
+    if (len <= FRAME_CODEC_MAX_SHORT_PAYLOAD) {
+        uint8_t packLen = static_cast<uint8_t>(len >= startByte ? (len + 1) : len);
+        crc = Crc8::proceed(CRC8_INIT, packLen);
+        size += 1;
+    } else {
+        uint8_t lenHi = static_cast<uint8_t>(len >> 8);
+        uint8_t lenLo = static_cast<uint8_t>(len);
+        crc = Crc8::proceed(Crc8::proceed(Crc8::proceed(CRC8_INIT, FRAME_CODEC_EXT_LEN), lenHi), lenLo);
+        size += 3 + (lenHi == startByte) + (lenLo == startByte);
+    }
+
+    crc = Crc8::crc(data, len, crc);
+    size += len + 1 + (crc == startByte);
+
+    // every SB in payload is doubled
+    const uint8_t* ptr = data;
+    const uint8_t* const end = data + len;
+    while (ptr < end) {
+        const uint8_t* sb = static_cast<const uint8_t*>(memchr(ptr, startByte, static_cast<size_t>(end - ptr)));
+        if (!sb) {
+            break;
+        }
+        ++size;
+        ptr = sb + 1;
+    }
+
+    return size;
+}
+
+int FrameEncoder::_encode(int len, const uint8_t* data, uint8_t* chunk, int chunkSize, const Sink* sink)
+{
+    if (len < 0 || len > FRAME_CODEC_MAX_PAYLOAD) {
+        return -1;
+    }
+
+    const uint8_t startByte = FRAME_CODEC_START_BYTE;
+    int pos = 0;
+    int total = 0;
+    uint8_t crc;
+
+    auto flush = [&]() {
+        if (sink && pos) {
+            (*sink)(chunk, pos);
+            total += pos;
+            pos = 0;
+        }
+    };
+
+    auto addByte = [&](uint8_t b) {
+        if ((pos + 2) > chunkSize) {
+            flush();
+        }
+        chunk[pos++] = b;
+        if (b == startByte) {
+            chunk[pos++] = b;
+        }
+    };
+
+    chunk[pos++] = startByte;
+
+    if (len <= FRAME_CODEC_MAX_SHORT_PAYLOAD) {
+        uint8_t packLen = static_cast<uint8_t>(len >= startByte ? (len + 1) : len);
+        crc = Crc8::proceed(CRC8_INIT, packLen);
+        chunk[pos++] = packLen;
+    } else {
+        uint8_t lenHi = static_cast<uint8_t>(len >> 8);
+        uint8_t lenLo = static_cast<uint8_t>(len);
+        crc = Crc8::proceed(CRC8_INIT, FRAME_CODEC_EXT_LEN);
+        crc = Crc8::proceed(crc, lenHi);
+        crc = Crc8::proceed(crc, lenLo);
+        chunk[pos++] = FRAME_CODEC_EXT_LEN;
+        addByte(lenHi);
+        addByte(lenLo);
+    }
+
+    crc = Crc8::crc(data, len, crc);
+
+    // payload: copy runs between SB at once, double every SB
+    const uint8_t* ptr = data;
+    const uint8_t* const end = data + len;
+    while (ptr < end) {
+        if ((pos + 2) > chunkSize) {
+            flush();
+        }
+
+        if (*ptr == startByte) {
+            while (ptr < end && *ptr == startByte && (pos + 2) <= chunkSize) {
+                chunk[pos++] = startByte;
+                chunk[pos++] = startByte;
+                ++ptr;
+            }
+            continue;
+        }
+
+        size_t limit = static_cast<size_t>(end - ptr);
+        if (limit > static_cast<size_t>(chunkSize - pos)) {
+            limit = static_cast<size_t>(chunkSize - pos);
+        }
+
+        const uint8_t* sb = static_cast<const uint8_t*>(memchr(ptr, startByte, limit));
+        size_t run = sb ? static_cast<size_t>(sb - ptr) : limit;
+
+        memcpy(chunk + pos, ptr, run);
+        pos += static_cast<int>(run);
+        ptr += run;
+    }
+
+    addByte(crc);
+    flush();
+
+    return sink ? total : pos;
+}
+
+
+// decoder ------------------------------------------------------------------------
+FrameDecoder::FrameDecoder()
+{
+
+}
+
+void FrameDecoder::on(std::function<void(int len, uint8_t*)> foo)
+{
+    m_handler = foo;
+}
+
+void FrameDecoder::reset()
+{
+    m_state = StateIdle;
+    m_triggerSB = false;
+    m_frameCrc = CRC8_INIT;
+    m_receivePos = 0;
+    m_receivePackLen = 0;
+}
+
+void FrameDecoder::proceed(const uint8_t* data, int len)
+{
+    const uint8_t* ptr = data;
+    const uint8_t* const end = data + len;
+
+    while (ptr < end) {
+        if (m_triggerSB) {
+            uint8_t ch = *ptr++;
+            m_triggerSB = false;
+            _proceedByte(ch, ch != m_startByte); //{SB}{SB} -> {SB}, {SB}{!SB} -> {SB} and newframe
+            continue;
+        }
+
+        if (m_state == StateData && ptr[0] == m_startByte) {
+            // escaped {SB}{SB} inside payload, worst case of all SB payload
+            const uint8_t* from = ptr;
+            while ((end - ptr) >= 2 && ptr[1] == m_startByte && ptr[0] == m_startByte && m_receivePos < m_receivePackLen) {
+                m_recBuffer[m_receivePos++] = m_startByte;
+                m_frameCrc = Crc8::proceed(m_frameCrc, m_startByte);
+                ptr += 2;
+            }
+
+            if (m_receivePos == m_receivePackLen) {
+                m_state = StateCrc;
+            }
+
+            if (ptr != from) {
+                continue;
+            }
+        } else if (m_state == StateData || m_state == StateIdle) {
+            // payload and garbage between frames: skip per byte dispatch up to next {SB}
+            size_t limit = static_cast<size_t>(end - ptr);
+            if (m_state == StateData && limit > static_cast<size_t>(m_receivePackLen - m_receivePos)) {
+                limit = m_receivePackLen - m_receivePos;
+            }
+
+            const uint8_t* sb = static_cast<const uint8_t*>(memchr(ptr, m_startByte, limit));
+            size_t run = sb ? static_cast<size_t>(sb - ptr) : limit;
+
+            if (m_state == StateData) {
+                memcpy(m_recBuffer + m_receivePos, ptr, run);
+                m_frameCrc = Crc8::crc(ptr, static_cast<int>(run), m_frameCrc);
+                m_receivePos += static_cast<uint16_t>(run);
+                if (m_receivePos == m_receivePackLen) {
+                    m_state = StateCrc;
+                }
+            }
+
+            ptr += run;
+            if (run) {
+                continue;
+            }
+        }
+
+        uint8_t ch = *ptr++;
+        if (ch == m_startByte) { //{!SB}{SB} -> set flag and skip step
+            m_triggerSB = true;
+        } else { //{!SB}{!SB} -> {!SB}
+            _proceedByte(ch, false);
+        }
+    }
+}
+
+void FrameDecoder::proceedBytewise(const uint8_t* data, int len)
+{
+    for (int  i = 0; i < len; ++i) {
+        auto ch = data[i];
+
+        if (m_triggerSB) {
+            if(ch == m_startByte) { //{SB}{SB} -> {SB}
+                _proceedByte(ch, false);
+            } else { //{SB}{!SB} -> {SB} and newframe
+                _proceedByte(ch, true);
+            }
+            m_triggerSB = false;
+        } else if (ch == m_startByte) { //{!SB}{SB} -> set flag and skip step
+            m_triggerSB = true;
+        } else { //{!SB}{!SB} -> {!SB}
+            _proceedByte(ch, false);
+        }
+    }
+}
+
+void FrameDecoder::_proceedByte(uint8_t ch, bool newFrame)
+{
+    if (newFrame) {
+        if (m_state != StateIdle) {
+            ++m_stats.resyncs;
+        }
+        m_frameCrc = CRC8_INIT;
+        m_state = StateLen;
+    }
+
+    switch (m_state) {
+    case StateLen:
+        m_receivePos = 0;
+        if (ch == FRAME_CODEC_EXT_LEN) {
+            m_state = StateLenHi;
+            break;
+        }
+
+        m_receivePackLen = ch;
+        if (m_receivePackLen > m_startByte) {
+            m_receivePackLen -= 1;
+        }
+        m_state = _dataState();
+        break;
+
+    case StateLenHi:
+        m_receivePackLen = static_cast<uint16_t>(ch << 8);
+        m_state = StateLenLo;
+        break;
+
+    case StateLenLo:
+        m_receivePackLen |= ch;
+        m_state = _dataState();
+        break;
+
+    case StateData:
+        m_recBuffer[m_receivePos++] = ch;
+        if (m_receivePos == m_receivePackLen) {
+            m_state = StateCrc;
+        }
+        break;
+
+    case StateCrc:
+        if (m_frameCrc != ch) {
+            ++m_stats.crcErrors;
+        } else {
+            ++m_stats.frames;
+            if (m_handler) {
+                m_handler(m_receivePackLen, m_recBuffer);
+            }
+        }
+        m_state = StateIdle;
+        return;
+
+    default: // StateIdle: wait for next frame
+        return;
+    }
+
+    m_frameCrc = Crc8::proceed(m_frameCrc, ch);
+}
+
+FrameDecoder::State FrameDecoder::_dataState()
+{
+    if (m_receivePackLen > FRAME_CODEC_MAX_PAYLOAD) {
+        ++m_stats.oversize;
+        return StateIdle; // does not fit buffer, drop and wait next frame
+    }
+    return m_receivePackLen ? StateData : StateCrc;
+}
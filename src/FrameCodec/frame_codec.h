@@ -0,0 +1,123 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stdint.h>
+#include <functional>
+#include "crc8.h"
+
+/*
+ * Bridge frame format (same on UART and on TCP side):
+ *
+ *  short frame (len <= FRAME_CODEC_MAX_SHORT_PAYLOAD):
+ *      {SB}{len}{data[0] ... data[len - 1]}{crc}
+ *
+ *  extended frame (FRAME_CODEC_MAX_SHORT_PAYLOAD < len <= FRAME_CODEC_MAX_PAYLOAD):
+ *      {SB}{0xFF}{len >> 8}{len & 0xFF}{data[0] ... data[len - 1]}{crc}
+ *
+ *  SB   - start byte 0x1A, every SB inside len/data/crc is doubled: {SB}{SB}
+ *  len  - payload length, len >= SB is sent as (len + 1) so it never equals SB,
+ *         0xFF marks extended frame with 16 bit big endian length
+ *  crc  - CRC-8 (poly 0x31, init 0xFF) over length bytes (as sent) and data
+ *
+ * Short frames are the same as before extended frames were introduced, only 254 byte
+ * payload now goes as extended frame. Build with FRAME_CODEC_MAX_PAYLOAD=253 for peers
+ * without extended frame support.
+ *
+ * This library is platform independent (no Arduino includes) and may be built
+ * on host for tests and benchmarks (see frame_codec.pri, frame_codec_test.cpp)
+ */
+
+#define FRAME_CODEC_START_BYTE      ((uint8_t)0x1A)
+#define FRAME_CODEC_EXT_LEN         ((uint8_t)0xFF)
+#define FRAME_CODEC_MAX_SHORT_PAYLOAD 253
+
+// max payload, all frame buffers are sized by it at compile time
+#ifndef FRAME_CODEC_MAX_PAYLOAD
+#   define FRAME_CODEC_MAX_PAYLOAD  1024
+#endif /* FRAME_CODEC_MAX_PAYLOAD */
+
+#if FRAME_CODEC_MAX_PAYLOAD > 0xFFFF
+#   error "FRAME_CODEC_MAX_PAYLOAD must fit 16 bit length"
+#endif
+
+#define FRAME_CODEC_BUFF_SIZE       FRAME_CODEC_MAX_PAYLOAD
+
+// worst case of encoded frame: SB + ext mark + (2 len bytes + data + crc) all doubled
+#define FRAME_CODEC_ENCODED_SIZE(len) (2 + 2 * ((len) + 3))
+// min chunk for streaming encoder: whole extended header
+#define FRAME_CODEC_MIN_CHUNK 6
+
+
+class FrameEncoder
+{
+public:
+    // receives encoded bytes, chunk by chunk
+    typedef std::function<void(const uint8_t* data, int len)> Sink;
+
+    // encode frame to out buffer (must be FRAME_CODEC_ENCODED_SIZE(len) bytes), returns encoded size or -1 if len is too big
+    static int encode(int len, const uint8_t* data, uint8_t* out);
+
+    // streaming encode: chunk buffer is filled and passed to sink every time it is full and at frame end,
+    // any frame size goes through chunkSize (>= FRAME_CODEC_MIN_CHUNK) bytes, returns encoded size or -1
+    static int encode(int len, const uint8_t* data, uint8_t* chunk, int chunkSize, const Sink& sink);
+
+    // exact encoded size of frame, or -1 if len is too big
+    static int encodedSize(int len, const uint8_t* data);
+
+private:
+    static int _encode(int len, const uint8_t* data, uint8_t* chunk, int chunkSize, const Sink* sink);
+};
+
+
+struct FrameDecoderStats
+{
+    uint32_t frames = 0;        // good frames passed to handler
+    uint32_t crcErrors = 0;
+    uint32_t resyncs = 0;       // new frame started before previous one was complete
+    uint32_t oversize = 0;      // frames longer than FRAME_CODEC_MAX_PAYLOAD dropped
+};
+
+class FrameDecoder
+{
+public:
+    FrameDecoder();
+
+    void on(std::function<void(int len, uint8_t*)>);
+    void reset();
+
+    // bulk path: runs between start bytes are found with memchr and copied at once
+    void proceed(const uint8_t* data, int len);
+    // reference path: every byte goes through state machine (for tests and benchmarks)
+    void proceedBytewise(const uint8_t* data, int len);
+
+    inline const FrameDecoderStats& stats() const {return m_stats;}
+    inline void resetStats() {m_stats = FrameDecoderStats();}
+
+private:
+    enum State : uint8_t {
+        StateIdle,      // wait for {SB}{!SB}
+        StateLen,
+        StateLenHi,     // extended frame length
+        StateLenLo,
+        StateData,
+        StateCrc
+    };
+
+    void _proceedByte(uint8_t byte, bool newFrame);
+    State _dataState();
+
+    std::function<void(int len, uint8_t*)> m_handler = nullptr;
+
+    const uint8_t m_startByte = FRAME_CODEC_START_BYTE;
+    uint8_t m_recBuffer[FRAME_CODEC_BUFF_SIZE];
+
+    State m_state = StateIdle;
+    bool m_triggerSB = false;
+    uint8_t m_frameCrc = CRC8_INIT;
+    uint16_t m_receivePos = 0;
+    uint16_t m_receivePackLen = 0;
+
+    FrameDecoderStats m_stats;
+};
+
+#endif /* FRAME_CODEC_H */
@@ -0,0 +1,13 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD	
+
+SOURCES += \
+    $$PWD/crc8.cpp \
+    $$PWD/frame_codec.cpp \
+    $$PWD/frame_codec_test.cpp
+
+HEADERS += \
+    $$PWD/command_table.h \
+    $$PWD/crc8.h \
+    $$PWD/frame_codec.h \
+    $$PWD/frame_codec_test.h
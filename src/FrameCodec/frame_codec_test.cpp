@@ -0,0 +1,497 @@
+// TEST: g++ -O2 -Wall -Wextra -I../TestUtil -DFRAME_CODEC_TEST_MAIN crc8.cpp frame_codec.cpp frame_codec_test.cpp -o frame_codec_test && ./frame_codec_test
+#include "frame_codec_test.h"
+#include "frame_codec.h"
+#include "crc8.h"
+#include "command_table.h"
+#include "test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <vector>
+
+#ifndef FRAME_CODEC_BENCH_STREAM_SIZE
+#   ifdef ARDUINO
+#       define FRAME_CODEC_BENCH_STREAM_SIZE (32 * 1024)
+#   else
+#       define FRAME_CODEC_BENCH_STREAM_SIZE (1024 * 1024)
+#   endif
+#endif /* FRAME_CODEC_BENCH_STREAM_SIZE */
+
+static uint32_t randState = 0x12345678U;
+static uint8_t randByte(void)
+{
+    // xorshift32, deterministic on every platform
+    randState ^= randState << 13;
+    randState ^= randState >> 17;
+    randState ^= randState << 5;
+    return static_cast<uint8_t>(randState);
+}
+
+static void fillPayload(uint8_t* buf, int len, int mode)
+{
+    for (int i = 0; i < len; ++i) {
+        switch (mode) {
+        case 0:  buf[i] = randByte(); break;
+        case 1:  buf[i] = FRAME_CODEC_START_BYTE; break;
+        default: buf[i] = static_cast<uint8_t>(i); break;
+        }
+    }
+}
+
+
+// tests ----------------------------------------------------------------------
+struct DecodedFrame {
+    int count = 0;
+    int len = -1;
+    uint8_t data[FRAME_CODEC_BUFF_SIZE];
+};
+
+typedef void (FrameDecoder::*DecodeFoo)(const uint8_t*, int);
+
+static void testRoundTrip(int mode, int chunk, DecodeFoo decode)
+{
+    uint8_t payload[FRAME_CODEC_MAX_PAYLOAD];
+    uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(FRAME_CODEC_MAX_PAYLOAD)];
+    DecodedFrame frame;
+
+    FrameDecoder decoder;
+    decoder.on([&frame](int len, uint8_t* data) {
+        ++frame.count;
+        frame.len = len;
+        memcpy(frame.data, data, len);
+    });
+
+    for (int len = 0; len <= FRAME_CODEC_MAX_PAYLOAD; ++len) {
+        fillPayload(payload, len, mode);
+        int size = FrameEncoder::encode(len, payload, encoded);
+        TEST_ASSERT("encoded size must fit worst case", size > 0 && size <= FRAME_CODEC_ENCODED_SIZE(len));
+
+        frame.count = 0;
+        for (int pos = 0; pos < size; pos += chunk) {
+            int n = (size - pos) < chunk ? (size - pos) : chunk;
+            (decoder.*decode)(encoded + pos, n);
+        }
+
+        TEST_ASSERT("frame must be decoded once", frame.count == 1);
+        TEST_ASSERT("decoded len must be equal", frame.len == len);
+        TEST_ASSERT("decoded data must be equal", memcmp(frame.data, payload, len) == 0);
+    }
+}
+
+static void testCorruptedCrc(void)
+{
+    uint8_t payload[32];
+    uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(32)];
+    int count = 0;
+
+    FrameDecoder decoder;
+    decoder.on([&count](int, uint8_t*) { ++count; });
+
+    fillPayload(payload, sizeof(payload), 2);
+    int size = FrameEncoder::encode(sizeof(payload), payload, encoded);
+    encoded[size - 1] ^= 0x01;
+    decoder.proceed(encoded, size);
+    TEST_ASSERT("frame with bad crc must be dropped", count == 0);
+
+    // decoder must resync on next start byte
+    size = FrameEncoder::encode(sizeof(payload), payload, encoded);
+    decoder.proceed(encoded, size);
+    TEST_ASSERT("decoder must resync after bad frame", count == 1);
+}
+
+static void testBackToBack(void)
+{
+    uint8_t payload[64];
+    uint8_t stream[8 * FRAME_CODEC_ENCODED_SIZE(64)];
+    int count = 0;
+    int size = 0;
+
+    FrameDecoder decoder;
+    decoder.on([&count](int len, uint8_t*) { if (len == 64) ++count; });
+
+    for (int i = 0; i < 8; ++i) {
+        fillPayload(payload, sizeof(payload), 0);
+        size += FrameEncoder::encode(sizeof(payload), payload, stream + size);
+    }
+    decoder.proceed(stream, size);
+    TEST_ASSERT("all back-to-back frames must be decoded", count == 8);
+}
+
+static void testCrc8(void)
+{
+    uint8_t buf[1027];
+    fillPayload(buf, sizeof(buf), 0);
+
+    // CRC-8/0x31 with init 0xFF of "123456789" is 0xF7
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT("bitwise crc check value", Crc8::crcBitwise(check, sizeof(check)) == 0xF7);
+
+    for (int len = 0; len <= (int)sizeof(buf); len += 17) {
+        for (int offset = 0; offset < 4; ++offset) {
+            const int n = len > offset ? len - offset : 0;
+            uint8_t ref = Crc8::crcBitwise(buf + offset, n);
+            TEST_ASSERT("table crc must match bitwise", Crc8::crcTable(buf + offset, n) == ref);
+            TEST_ASSERT("bulk crc must match bitwise", Crc8::crc(buf + offset, n) == ref);
+#if CRC8_SLICE_BY_4
+            TEST_ASSERT("slice4 crc must match bitwise", Crc8::crcSlice4(buf + offset, n) == ref);
+#endif /* CRC8_SLICE_BY_4 */
+        }
+    }
+
+    // continuation
+    uint8_t part = Crc8::crc(buf, 100);
+    TEST_ASSERT("crc continuation", Crc8::crc(buf + 100, 200, part) == Crc8::crcBitwise(buf, 300));
+}
+
+static void testBulkMatchesBytewise(void)
+{
+    // random frames mixed with garbage and broken frames, random chunking
+    const int streamSize = 256 * 1024;
+    std::vector<uint8_t> stream(streamSize);
+    uint8_t payload[FRAME_CODEC_MAX_PAYLOAD];
+    int size = 0;
+
+    while (size + FRAME_CODEC_ENCODED_SIZE(FRAME_CODEC_MAX_PAYLOAD) + 16 < streamSize) {
+        int len = ((randByte() << 8) | randByte()) % (FRAME_CODEC_MAX_PAYLOAD + 1);
+        fillPayload(payload, len, (randByte() & 0x07) == 0 ? 1 : 0);
+        int n = FrameEncoder::encode(len, payload, stream.data() + size);
+
+        switch (randByte() & 0x07) {
+        case 0:  stream[size + n / 2] ^= 0x5A; break;  // corrupt
+        case 1:  n = n / 2; break;                     // truncate
+        default: break;
+        }
+        size += n;
+
+        if ((randByte() & 0x03) == 0) {
+            int garbage = randByte() & 0x0F;
+            fillPayload(stream.data() + size, garbage, 0);
+            size += garbage;
+        }
+    }
+
+    std::vector<uint8_t> bulkOut, refOut;
+    FrameDecoder bulk, ref;
+    bulk.on([&bulkOut](int len, uint8_t* data) { bulkOut.push_back(static_cast<uint8_t>(len)); bulkOut.insert(bulkOut.end(), data, data + len); });
+    ref.on([&refOut](int len, uint8_t* data) { refOut.push_back(static_cast<uint8_t>(len)); refOut.insert(refOut.end(), data, data + len); });
+
+    ref.proceedBytewise(stream.data(), size);
+    for (int pos = 0; pos < size; ) {
+        int n = 1 + (randByte() % 300);
+        if (n > size - pos) {
+            n = size - pos;
+        }
+        bulk.proceed(stream.data() + pos, n);
+        pos += n;
+    }
+
+    TEST_ASSERT("bulk decoder must find some frames", !refOut.empty());
+    TEST_ASSERT("bulk decoder must match bytewise decoder", bulkOut == refOut);
+}
+
+static void testStreamingEncoder(void)
+{
+    static const int chunks[] = {FRAME_CODEC_MIN_CHUNK, 7, 64, 1460};
+    uint8_t payload[FRAME_CODEC_MAX_PAYLOAD];
+    uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(FRAME_CODEC_MAX_PAYLOAD)];
+    std::vector<uint8_t> chunk;
+    std::vector<uint8_t> streamed;
+    bool chunkOverrun = false;
+
+    for (int mode = 0; mode < 3; ++mode) {
+        for (int len = 0; len <= FRAME_CODEC_MAX_PAYLOAD; len += (len < 300 ? 1 : 37)) {
+            fillPayload(payload, len, mode);
+            int size = FrameEncoder::encode(len, payload, encoded);
+            TEST_ASSERT("exact encoded size", FrameEncoder::encodedSize(len, payload) == size);
+
+            for (int chunkSize : chunks) {
+                chunk.assign(chunkSize, 0);
+                streamed.clear();
+                int total = FrameEncoder::encode(len, payload, chunk.data(), chunkSize, [&](const uint8_t* data, int n) {
+                    chunkOverrun |= (n <= 0 || n > chunkSize);
+                    streamed.insert(streamed.end(), data, data + n);
+                });
+
+                TEST_ASSERT("streamed size must match", total == size && static_cast<int>(streamed.size()) == size);
+                TEST_ASSERT("streamed frame must match", memcmp(streamed.data(), encoded, size) == 0);
+            }
+        }
+    }
+
+    TEST_ASSERT("streaming chunks must fit chunk buffer", !chunkOverrun);
+    TEST_ASSERT("too small chunk must be rejected", FrameEncoder::encode(1, payload, encoded, FRAME_CODEC_MIN_CHUNK - 1, [](const uint8_t*, int) {}) == -1);
+}
+
+static void testShortFrameCompatible(void)
+{
+    uint8_t payload[FRAME_CODEC_MAX_SHORT_PAYLOAD + 1];
+    uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(FRAME_CODEC_MAX_SHORT_PAYLOAD + 1)];
+    fillPayload(payload, sizeof(payload), 2);
+
+    FrameEncoder::encode(10, payload, encoded);
+    TEST_ASSERT("short len below SB is sent as is", encoded[1] == 10);
+    FrameEncoder::encode(FRAME_CODEC_START_BYTE, payload, encoded);
+    TEST_ASSERT("short len SB is sent as SB + 1", encoded[1] == FRAME_CODEC_START_BYTE + 1);
+    FrameEncoder::encode(FRAME_CODEC_MAX_SHORT_PAYLOAD, payload, encoded);
+    TEST_ASSERT("max short len is sent in one byte", encoded[1] == FRAME_CODEC_MAX_SHORT_PAYLOAD + 1);
+
+#if FRAME_CODEC_MAX_PAYLOAD > FRAME_CODEC_MAX_SHORT_PAYLOAD
+    FrameEncoder::encode(FRAME_CODEC_MAX_SHORT_PAYLOAD + 1, payload, encoded);
+    TEST_ASSERT("long frame must be extended", encoded[1] == FRAME_CODEC_EXT_LEN && encoded[2] == 0x00 && encoded[3] == FRAME_CODEC_MAX_SHORT_PAYLOAD + 1);
+#endif /* FRAME_CODEC_MAX_PAYLOAD > FRAME_CODEC_MAX_SHORT_PAYLOAD */
+}
+
+static void testOversize(void)
+{
+    uint8_t payload[FRAME_CODEC_MAX_PAYLOAD + 1];
+    uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(FRAME_CODEC_MAX_PAYLOAD + 1)];
+    fillPayload(payload, sizeof(payload), 2);
+    TEST_ASSERT("oversize payload must be rejected", FrameEncoder::encode(sizeof(payload), payload, encoded) == -1);
+
+    // oversize extended frame from peer must be dropped, next frame decoded
+    int count = 0;
+    FrameDecoder decoder;
+    decoder.on([&count](int, uint8_t*) { ++count; });
+
+    const uint16_t len = FRAME_CODEC_MAX_PAYLOAD + 1;
+    uint8_t header[] = {FRAME_CODEC_START_BYTE, FRAME_CODEC_EXT_LEN, static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len)};
+    decoder.proceed(header, sizeof(header));
+    decoder.proceed(payload, sizeof(payload));
+
+    int size = FrameEncoder::encode(16, payload, encoded);
+    decoder.proceed(encoded, size);
+    TEST_ASSERT("oversize frame must be dropped", count == 1);
+    TEST_ASSERT("oversize frame must be counted", decoder.stats().oversize == 1 && decoder.stats().frames == 1);
+}
+
+static void testDecoderStats(void)
+{
+    uint8_t payload[64];
+    uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(64)];
+    fillPayload(payload, sizeof(payload), 2);
+    int size = FrameEncoder::encode(sizeof(payload), payload, encoded);
+
+    FrameDecoder decoder;
+    decoder.proceed(encoded, size);
+
+    // bad CRC: payload byte 5 -> 0x85
+    encoded[2 + 5] ^= 0x80;
+    decoder.proceed(encoded, size);
+    encoded[2 + 5] ^= 0x80;
+
+    // frame cut in half by next frame
+    decoder.proceed(encoded, size / 2);
+    decoder.proceed(encoded, size);
+
+    const FrameDecoderStats& stats = decoder.stats();
+    TEST_ASSERT("stats: good frames", stats.frames == 2);
+    TEST_ASSERT("stats: crc errors", stats.crcErrors == 1);
+    TEST_ASSERT("stats: resyncs", stats.resyncs == 1);
+
+    decoder.resetStats();
+    TEST_ASSERT("stats: reset", decoder.stats().frames == 0 && decoder.stats().crcErrors == 0);
+}
+
+static int commandCalls = 0;
+static int commandLastLen = -1;
+static void commandFoo(int len, uint8_t*) { ++commandCalls; commandLastLen = len; }
+
+struct CommandObject {
+    int sum = 0;
+    void proceed(int len, uint8_t* data) { for (int i = 0; i < len; ++i) sum += data[i]; }
+};
+
+static void testCommandTable(void)
+{
+    CommandTable table;
+    CommandObject obj;
+    int ctxCalls = 0;
+    uint8_t frame[] = {1, 2, 3, 4};
+
+    TEST_ASSERT("empty frame is not dispatched", !table.dispatch(0, frame));
+    TEST_ASSERT("unknown command is not dispatched", !table.dispatch(sizeof(frame), frame));
+
+    table.on(1, commandFoo);
+    TEST_ASSERT("plain function dispatch", table.dispatch(sizeof(frame), frame) && commandCalls == 1 && commandLastLen == 3);
+
+    table.on(1, CommandHandler::bind<CommandObject, &CommandObject::proceed>(&obj));
+    TEST_ASSERT("method dispatch replaces handler", table.dispatch(sizeof(frame), frame) && commandCalls == 1 && obj.sum == 9);
+
+    table.on(0xFF, CommandHandler([](void* ctx, int, uint8_t*) { ++(*static_cast<int*>(ctx)); }, &ctxCalls));
+    frame[0] = 0xFF;
+    TEST_ASSERT("context dispatch", table.dispatch(1, frame) && ctxCalls == 1);
+
+    table.off(0xFF);
+    TEST_ASSERT("removed command is not dispatched", !table.dispatch(1, frame) && !table.has(0xFF));
+}
+
+int frameCodecTest(void)
+{
+    failCount = 0;
+
+    for (int mode = 0; mode < 3; ++mode) {
+        testRoundTrip(mode, 1, &FrameDecoder::proceed);
+        testRoundTrip(mode, 7, &FrameDecoder::proceed);
+        testRoundTrip(mode, 4096, &FrameDecoder::proceed);
+        testRoundTrip(mode, 7, &FrameDecoder::proceedBytewise);
+    }
+    testBulkMatchesBytewise();
+    testCrc8();
+    testCorruptedCrc();
+    testBackToBack();
+    testStreamingEncoder();
+    testCommandTable();
+    testShortFrameCompatible();
+    testOversize();
+    testDecoderStats();
+
+    printf("frame codec test: %s (%d failed)\n", failCount ? "FAILED" : "OK", failCount);
+    return failCount;
+}
+
+
+// benchmark ------------------------------------------------------------------
+static double elapsedSec(std::chrono::steady_clock::time_point from)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - from).count();
+}
+
+static void benchmarkPayload(const char* name, int mode, int len)
+{
+    const int streamSize = FRAME_CODEC_BENCH_STREAM_SIZE;
+    std::vector<uint8_t> stream(streamSize);
+    uint8_t payload[FRAME_CODEC_MAX_PAYLOAD];
+
+    fillPayload(payload, len, mode);
+
+    // encode ---------------------------
+    int frames = 0;
+    int size = 0;
+    auto start = std::chrono::steady_clock::now();
+    while ((size + FRAME_CODEC_ENCODED_SIZE(len)) <= streamSize) {
+        size += FrameEncoder::encode(len, payload, stream.data() + size);
+        ++frames;
+    }
+    double encodeSec = elapsedSec(start);
+
+    // streaming encode through small chunk -------
+    uint8_t chunk[128];
+    int streamed = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+        FrameEncoder::encode(len, payload, chunk, sizeof(chunk), [&streamed](const uint8_t*, int n) { streamed += n; });
+    }
+    double streamSec = elapsedSec(start);
+
+    // decode ---------------------------
+    int decoded = 0;
+    FrameDecoder decoder;
+    decoder.on([&decoded](int, uint8_t*) { ++decoded; });
+
+    start = std::chrono::steady_clock::now();
+    decoder.proceedBytewise(stream.data(), size);
+    double bytewiseSec = elapsedSec(start);
+
+    start = std::chrono::steady_clock::now();
+    decoder.proceed(stream.data(), size);
+    double decodeSec = elapsedSec(start);
+
+    double payloadMb = (static_cast<double>(frames) * len) / (1024.0 * 1024.0);
+    printf("%-8s len %4d: encode %8.2f MB/s, stream %8.2f MB/s, decode bytewise %8.2f MB/s, bulk %8.2f MB/s (%d/%d frames)\n",
+           name, len, payloadMb / encodeSec, payloadMb / streamSec, payloadMb / bytewiseSec, payloadMb / decodeSec, decoded, 2 * frames);
+}
+
+static void benchmarkCrc(const char* name, uint8_t (*foo)(const uint8_t*, int, uint8_t))
+{
+    const int size = FRAME_CODEC_BENCH_STREAM_SIZE;
+    const int rounds = 16;
+    std::vector<uint8_t> buf(size);
+    fillPayload(buf.data(), size, 0);
+
+    volatile uint8_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        sink = sink ^ foo(buf.data(), size, CRC8_INIT);
+    }
+    double sec = elapsedSec(start);
+
+    double mb = (static_cast<double>(size) * rounds) / (1024.0 * 1024.0);
+    printf("crc8 %-8s: %8.2f MB/s\n", name, mb / sec);
+}
+
+static volatile int benchSink = 0;
+static void benchHandler(int len, uint8_t* data) { benchSink = benchSink + len + data[0]; }
+
+static void benchmarkDispatch(void)
+{
+    // 8 registered commands, frames with random command ids (half of them unknown)
+    const int frames = 1 << 16;
+    const int rounds = 32;
+    std::vector<uint8_t> cmds(frames);
+    for (int i = 0; i < frames; ++i) {
+        cmds[i] = randByte() & 0x0F;
+    }
+
+    std::map<uint8_t, std::function<void(int len, uint8_t*)>> map;
+    CommandTable table;
+    for (uint8_t cmd = 0; cmd < 8; ++cmd) {
+        map.insert({cmd, benchHandler});
+        table.on(cmd, benchHandler);
+    }
+
+    uint8_t frame[16] = {0};
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < frames; ++i) {
+            frame[0] = cmds[i];
+            auto s = map.find(frame[0]);
+            if (s != map.end()) {
+                s->second(sizeof(frame) - 1, frame + 1);
+            }
+        }
+    }
+    double mapSec = elapsedSec(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < frames; ++i) {
+            frame[0] = cmds[i];
+            table.dispatch(sizeof(frame), frame);
+        }
+    }
+    double tableSec = elapsedSec(start);
+
+    const double count = static_cast<double>(frames) * rounds;
+    printf("dispatch: std::map + std::function %6.2f ns/frame, table %6.2f ns/frame\n",
+           mapSec * 1e9 / count, tableSec * 1e9 / count);
+}
+
+void frameCodecBenchmark(void)
+{
+    static const int lens[] = {8, 64, 253, FRAME_CODEC_MAX_PAYLOAD};
+
+    benchmarkDispatch();
+    benchmarkCrc("bitwise", Crc8::crcBitwise);
+    benchmarkCrc("table", Crc8::crcTable);
+#if CRC8_SLICE_BY_4
+    benchmarkCrc("slice4", Crc8::crcSlice4);
+#endif /* CRC8_SLICE_BY_4 */
+
+    for (int len : lens) {
+        benchmarkPayload("random", 0, len);
+        benchmarkPayload("all SB", 1, len);
+    }
+}
+
+
+#ifdef FRAME_CODEC_TEST_MAIN
+int main(void)
+{
+    int failed = frameCodecTest();
+    frameCodecBenchmark();
+    return failed ? 1 : 0;
+}
+#endif /* FRAME_CODEC_TEST_MAIN */
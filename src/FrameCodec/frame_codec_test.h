@@ -0,0 +1,8 @@
+#ifndef FRAME_CODEC_TEST_H
+#define FRAME_CODEC_TEST_H
+
+// returns count of failed checks
+int frameCodecTest(void);
+void frameCodecBenchmark(void);
+
+#endif /* FRAME_CODEC_TEST_H */
@@ -0,0 +1,325 @@
+#include "reliable_link.h"
+#include <string.h>
+
+
+ReliableLink::ReliableLink(Clock clock) :
+    m_clock(clock)
+{
+    m_stats.rtoMs = m_rto;
+}
+
+void ReliableLink::output(Output output)
+{
+    m_output = output;
+}
+
+void ReliableLink::reset(uint8_t epoch)
+{
+    for (int i = 0; i < RELIABLE_LINK_WINDOW; ++i) {
+        m_window[i].used = false;
+    }
+    m_txBase = 0;
+    m_txNext = 0;
+    m_txEpoch = epoch;
+}
+
+void ReliableLink::on(std::function<void(int len, uint8_t*)> foo)
+{
+    m_handler = foo;
+}
+
+int ReliableLink::inFlight() const
+{
+    return static_cast<uint16_t>(m_txNext - m_txBase);
+}
+
+
+// sender -----------------------------------------------------------------------------
+bool ReliableLink::send(int len, const uint8_t* data)
+{
+    if (len < 0 || len > RELIABLE_LINK_MAX_PAYLOAD) {
+        return false;
+    }
+
+    if (!canSend()) {
+        ++m_stats.windowFull;
+        return false;
+    }
+
+    const uint16_t seq = m_txNext++;
+    Slot& slot = _slot(seq);
+    slot.used = true;
+    slot.tries = 0;
+    slot.len = static_cast<uint16_t>(RELIABLE_LINK_DATA_HEADER + len);
+    slot.data[0] = RELIABLE_LINK_CMD_DATA;
+    slot.data[1] = m_txEpoch;
+    slot.data[2] = static_cast<uint8_t>(seq >> 8);
+    slot.data[3] = static_cast<uint8_t>(seq);
+    memcpy(slot.data + RELIABLE_LINK_DATA_HEADER, data, len);
+
+    ++m_stats.sent;
+    _transmit(slot);
+    return true;
+}
+
+void ReliableLink::poll()
+{
+    const uint32_t now = m_clock();
+
+    for (uint16_t seq = m_txBase; seq != m_txNext; ++seq) {
+        Slot& slot = _slot(seq);
+        if (!slot.used || (now - slot.sentMs) < _timeout(slot)) {
+            continue;
+        }
+
+        if (slot.tries >= RELIABLE_LINK_MAX_TRIES) {
+            slot.used = false; // give up, window must go on
+            ++m_stats.failed;
+            continue;
+        }
+
+        ++m_stats.retransmits;
+        _transmit(slot);
+    }
+
+    _advance();
+}
+
+void ReliableLink::_transmit(Slot& slot)
+{
+    slot.sentMs = m_clock();
+    ++slot.tries;
+    if (m_output) {
+        m_output(slot.len, slot.data);
+    }
+}
+
+uint32_t ReliableLink::_timeout(const Slot& slot) const
+{
+    uint32_t timeout = m_rto << (slot.tries > 1 ? (slot.tries - 1) : 0);
+    return timeout > RELIABLE_LINK_RTO_MAX_MS ? RELIABLE_LINK_RTO_MAX_MS : timeout;
+}
+
+void ReliableLink::ackFrame(int len, uint8_t* data)
+{
+    if (len < (RELIABLE_LINK_ACK_SIZE - 1)) {
+        return;
+    }
+
+    // ACK of other session (answer to frames sent before reset())
+    if (data[0] != m_txEpoch) {
+        return;
+    }
+
+    const uint32_t now = m_clock();
+    const uint16_t next = static_cast<uint16_t>((data[1] << 8) | data[2]);
+    const uint32_t bitmap = (static_cast<uint32_t>(data[3]) << 24) | (static_cast<uint32_t>(data[4]) << 16) |
+                            (static_cast<uint32_t>(data[5]) << 8) | data[6];
+
+    // next behind m_txBase: receiver still waits for frame given up here (until it sees
+    // seq >= hole + window), its bitmap is valid; ACK for frames never sent is ignored
+    uint16_t acked = next;
+    if (static_cast<uint16_t>(next - m_txBase) > static_cast<uint16_t>(m_txNext - m_txBase)) {
+        if (static_cast<uint16_t>(m_txBase - next) > RELIABLE_LINK_WINDOW) {
+            return;
+        }
+        acked = m_txBase;
+    }
+
+    // cumulative
+    for (uint16_t seq = m_txBase; seq != acked; ++seq) {
+        _ack(seq, now);
+    }
+
+    // selective, highest SACKed frame shows holes below it
+    uint16_t highest = acked;
+    for (int i = 0; i < 32 && bitmap; ++i) {
+        if (bitmap & (1UL << i)) {
+            const uint16_t seq = static_cast<uint16_t>(next + 1 + i);
+            if (static_cast<uint16_t>(seq - m_txBase) < static_cast<uint16_t>(m_txNext - m_txBase)) {
+                _ack(seq, now);
+                highest = seq;
+            }
+        }
+    }
+
+    // fast retransmit of holes, once per frame (then timeout takes over) and not before RTT passed
+    if (m_srtt) {
+        for (uint16_t seq = acked; seq != highest; ++seq) {
+            Slot& slot = _slot(seq);
+            if (slot.used && slot.tries == 1 && (now - slot.sentMs) >= m_srtt) {
+                ++m_stats.fastRetransmits;
+                _transmit(slot);
+            }
+        }
+    }
+
+    _advance();
+}
+
+void ReliableLink::_ack(uint16_t seq, uint32_t now)
+{
+    Slot& slot = _slot(seq);
+    if (!slot.used) {
+        return;
+    }
+
+    // Karn: retransmitted frames give no RTT sample
+    if (slot.tries == 1) {
+        _rttSample(now - slot.sentMs);
+    }
+    slot.used = false;
+    ++m_stats.acked;
+}
+
+void ReliableLink::_advance()
+{
+    while (m_txBase != m_txNext && !_slot(m_txBase).used) {
+        ++m_txBase;
+    }
+}
+
+void ReliableLink::_rttSample(uint32_t rtt)
+{
+    // RFC 6298
+    if (m_srtt == 0) {
+        m_srtt = rtt ? rtt : 1;
+        m_rttVar = rtt / 2;
+    } else {
+        const uint32_t err = rtt > m_srtt ? (rtt - m_srtt) : (m_srtt - rtt);
+        m_rttVar = (3 * m_rttVar + err) / 4;
+        m_srtt = (7 * m_srtt + rtt) / 8;
+        if (m_srtt == 0) {
+            m_srtt = 1;
+        }
+    }
+
+    m_rto = m_srtt + 4 * m_rttVar;
+    if (m_rto < RELIABLE_LINK_RTO_MIN_MS) {
+        m_rto = RELIABLE_LINK_RTO_MIN_MS;
+    } else if (m_rto > RELIABLE_LINK_RTO_MAX_MS) {
+        m_rto = RELIABLE_LINK_RTO_MAX_MS;
+    }
+
+    m_stats.rtoMs = m_rto;
+    m_stats.srttMs = m_srtt;
+}
+
+
+// receiver ---------------------------------------------------------------------------
+bool ReliableLink::input(int len, uint8_t* data)
+{
+    if (len < 1) {
+        return false;
+    }
+
+    if (data[0] == RELIABLE_LINK_CMD_DATA) {
+        dataFrame(len - 1, data + 1);
+        return true;
+    }
+
+    if (data[0] == RELIABLE_LINK_CMD_ACK) {
+        ackFrame(len - 1, data + 1);
+        return true;
+    }
+
+    return false;
+}
+
+void ReliableLink::dataFrame(int len, uint8_t* data)
+{
+    if (len < (RELIABLE_LINK_DATA_HEADER - 1)) {
+        return;
+    }
+
+    const uint8_t epoch = data[0];
+    const uint16_t seq = static_cast<uint16_t>((data[1] << 8) | data[2]);
+    if (!_rxSession(epoch, seq)) {
+        ++m_stats.stale;
+        return;
+    }
+
+    int16_t diff = static_cast<int16_t>(seq - m_rxNext);
+
+    // sender window is bounded, so everything older than (seq - window) is acked or
+    // given up by sender: holes there will never be filled
+    while (diff >= RELIABLE_LINK_WINDOW) {
+        ++m_stats.skipped;
+        _rxAdvance();
+        diff = static_cast<int16_t>(seq - m_rxNext);
+    }
+
+    bool fresh = false;
+    if (diff == 0) {
+        fresh = true;
+        _rxAdvance();
+    } else if (diff > 0) {
+        const uint32_t bit = 1UL << (diff - 1);
+        fresh = !(m_rxBitmap & bit);
+        m_rxBitmap |= bit;
+    }
+
+    if (fresh) {
+        ++m_stats.delivered;
+        if (m_handler) {
+            m_handler(len - (RELIABLE_LINK_DATA_HEADER - 1), data + (RELIABLE_LINK_DATA_HEADER - 1));
+        }
+    } else {
+        ++m_stats.duplicates;
+    }
+
+    _sendAck();
+}
+
+// returns false for late frame of previous epoch, new epoch (or first frame) starts session
+bool ReliableLink::_rxSession(uint8_t epoch, uint16_t seq)
+{
+    if (m_rxSynced && epoch == m_rxEpoch) {
+        return true;
+    }
+    if (m_rxPrevValid && epoch == m_rxPrevEpoch) {
+        return false;
+    }
+
+    if (m_rxSynced) {
+        ++m_stats.sessions;
+        m_rxPrevEpoch = m_rxEpoch;
+        m_rxPrevValid = true;
+    }
+    m_rxSynced = true;
+    m_rxEpoch = epoch;
+    // new session starts at 0, frames before seq may come later while it is in first window
+    m_rxNext = seq < RELIABLE_LINK_WINDOW ? 0 : seq;
+    m_rxBitmap = 0;
+    return true;
+}
+
+// m_rxNext is done, move to next frame which is not received yet
+void ReliableLink::_rxAdvance()
+{
+    bool received;
+    do {
+        ++m_rxNext;
+        received = m_rxBitmap & 1U;
+        m_rxBitmap >>= 1;
+    } while (received);
+}
+
+void ReliableLink::_sendAck()
+{
+    uint8_t ack[RELIABLE_LINK_ACK_SIZE] = {
+        RELIABLE_LINK_CMD_ACK,
+        m_rxEpoch,
+        static_cast<uint8_t>(m_rxNext >> 8),
+        static_cast<uint8_t>(m_rxNext),
+        static_cast<uint8_t>(m_rxBitmap >> 24),
+        static_cast<uint8_t>(m_rxBitmap >> 16),
+        static_cast<uint8_t>(m_rxBitmap >> 8),
+        static_cast<uint8_t>(m_rxBitmap)
+    };
+
+    ++m_stats.acksSent;
+    if (m_output) {
+        m_output(sizeof(ack), ack);
+    }
+}
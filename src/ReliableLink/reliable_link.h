@@ -0,0 +1,159 @@
+#ifndef RELIABLE_LINK_H
+#define RELIABLE_LINK_H
+
+#include <stdint.h>
+#include <functional>
+#include "frame_codec.h"
+
+/*
+ * Reliable datagrams over unreliable frame transport (UdpTransport), platform
+ * independent, same frame format as everything else. Reliable frames use two reserved
+ * command bytes, so they coexist with ordinary (unreliable) command frames:
+ *
+ *  data: {RELIABLE_LINK_CMD_DATA}{epoch}{seq >> 8}{seq & 0xFF}{payload}
+ *  ack : {RELIABLE_LINK_CMD_ACK}{epoch}{next >> 8}{next & 0xFF}{bitmap 4 bytes, big endian}
+ *
+ *  epoch  - session of sender, ACK echoes epoch of data it answers
+ *  seq    - 16 bit sequence ID of every reliable frame
+ *  next   - cumulative ACK: every seq before next was received
+ *  bitmap - selective ACK: bit i set -> seq (next + 1 + i) was received
+ *
+ * Sender keeps up to RELIABLE_LINK_WINDOW unacknowledged frames, send() fails when
+ * window is full. Only missing frames are retransmitted: on timeout (RTO from smoothed
+ * RTT, doubled per try) or at once when ACK shows later frames arrived (hole in SACK
+ * bitmap). Receiver delivers every frame exactly once as soon as it arrives (no
+ * head-of-line blocking, so frames may be delivered out of order) and sends ACK for
+ * every data frame.
+ *
+ * Session: reset(epoch) starts sender again at seq 0 with new epoch (call it at boot with
+ * random epoch). Receiver that sees new epoch drops its state and starts with it, so
+ * peer restart is not taken as duplicates; late frames of previous epoch are dropped and
+ * ACKs of other epoch are ignored. Fresh receiver joins running session at first frame
+ * it gets (seq < RELIABLE_LINK_WINDOW -> session start, earlier frames may still come).
+ *
+ * Host test over loopback UDP with injected loss: reliable_link_test.cpp.
+ */
+
+#define RELIABLE_LINK_CMD_DATA ((uint8_t)0xF0)
+#define RELIABLE_LINK_CMD_ACK  ((uint8_t)0xF1)
+
+#define RELIABLE_LINK_DATA_HEADER 4
+#define RELIABLE_LINK_ACK_SIZE 8
+
+// unacknowledged frames in flight (<= 32, selective ACK bitmap size)
+#ifndef RELIABLE_LINK_WINDOW
+#   define RELIABLE_LINK_WINDOW 16
+#endif /* RELIABLE_LINK_WINDOW */
+
+// max payload of reliable frame, window keeps copy of every frame
+#ifndef RELIABLE_LINK_MAX_PAYLOAD
+#   define RELIABLE_LINK_MAX_PAYLOAD 256
+#endif /* RELIABLE_LINK_MAX_PAYLOAD */
+
+#define RELIABLE_LINK_RTO_INIT_MS 200U
+#define RELIABLE_LINK_RTO_MIN_MS 20U
+#define RELIABLE_LINK_RTO_MAX_MS 2000U
+#define RELIABLE_LINK_MAX_TRIES 10  // frame is given up after it
+
+#if RELIABLE_LINK_WINDOW > 32 || RELIABLE_LINK_WINDOW < 1
+#   error "RELIABLE_LINK_WINDOW must be 1 ... 32"
+#endif
+
+#if (RELIABLE_LINK_MAX_PAYLOAD + RELIABLE_LINK_DATA_HEADER) > FRAME_CODEC_MAX_PAYLOAD
+#   error "RELIABLE_LINK_MAX_PAYLOAD does not fit frame"
+#endif
+
+struct ReliableLinkStats
+{
+    uint32_t sent = 0;          // new reliable frames
+    uint32_t retransmits = 0;   // by timeout
+    uint32_t fastRetransmits = 0; // by SACK hole
+    uint32_t acked = 0;
+    uint32_t failed = 0;        // given up after RELIABLE_LINK_MAX_TRIES
+    uint32_t windowFull = 0;    // send() rejected
+    uint32_t delivered = 0;
+    uint32_t duplicates = 0;    // received again (lost ACK), ACKed and dropped
+    uint32_t skipped = 0;       // holes passed because sender gave them up
+    uint32_t sessions = 0;      // new epoch from peer (peer restarted)
+    uint32_t stale = 0;         // frames of previous epoch dropped
+    uint32_t acksSent = 0;
+    uint32_t rtoMs = 0;         // current retransmit timeout
+    uint32_t srttMs = 0;        // smoothed round trip time
+};
+
+class ReliableLink
+{
+public:
+    typedef uint32_t (*Clock)(void);
+    // frame payload (command byte first) which transport must send as one frame
+    typedef std::function<void(int len, uint8_t* data)> Output;
+
+    ReliableLink(Clock clock);
+
+    void output(Output output);
+    // new sender session: window dropped, seq from 0, peer receiver resets on new epoch
+    void reset(uint8_t epoch);
+    // reliable payload, once per frame
+    void on(std::function<void(int len, uint8_t*)>);
+
+    // returns false if window is full or payload is too long
+    bool send(int len, const uint8_t* data);
+
+    // received frame payload, returns false if it is not reliable link frame
+    bool input(int len, uint8_t* data);
+    // same, for command table handlers (command byte already removed)
+    void dataFrame(int len, uint8_t* data);
+    void ackFrame(int len, uint8_t* data);
+
+    // retransmit timed out frames, call often
+    void poll();
+
+    int inFlight() const;
+    inline bool canSend() const {return inFlight() < RELIABLE_LINK_WINDOW;}
+    inline uint8_t epoch() const {return m_txEpoch;}
+    inline const ReliableLinkStats& stats() const {return m_stats;}
+
+private:
+    struct Slot {
+        bool used = false;
+        uint8_t tries = 0;
+        uint16_t len = 0;           // with header
+        uint32_t sentMs = 0;
+        uint8_t data[RELIABLE_LINK_DATA_HEADER + RELIABLE_LINK_MAX_PAYLOAD];
+    };
+
+    inline Slot& _slot(uint16_t seq) {return m_window[seq % RELIABLE_LINK_WINDOW];}
+    void _transmit(Slot& slot);
+    void _ack(uint16_t seq, uint32_t now);
+    void _advance();
+    void _rxAdvance();
+    bool _rxSession(uint8_t epoch, uint16_t seq);
+    void _sendAck();
+    void _rttSample(uint32_t rtt);
+    uint32_t _timeout(const Slot& slot) const;
+
+    Clock m_clock;
+    Output m_output = nullptr;
+    std::function<void(int len, uint8_t*)> m_handler = nullptr;
+
+    // sender
+    Slot m_window[RELIABLE_LINK_WINDOW];
+    uint16_t m_txBase = 0;          // oldest unacknowledged
+    uint16_t m_txNext = 0;          // next new seq
+    uint8_t m_txEpoch = 0;
+    uint32_t m_srtt = 0;
+    uint32_t m_rttVar = 0;
+    uint32_t m_rto = RELIABLE_LINK_RTO_INIT_MS;
+
+    // receiver
+    bool m_rxSynced = false;        // m_rxEpoch is valid
+    bool m_rxPrevValid = false;
+    uint8_t m_rxEpoch = 0;
+    uint8_t m_rxPrevEpoch = 0;      // late frames of it are dropped
+    uint16_t m_rxNext = 0;          // all before it are delivered
+    uint32_t m_rxBitmap = 0;        // bit i -> (m_rxNext + 1 + i) delivered
+
+    ReliableLinkStats m_stats;
+};
+
+#endif /* RELIABLE_LINK_H */
@@ -0,0 +1,10 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD	
+
+SOURCES += \
+    $$PWD/reliable_link.cpp \
+    $$PWD/reliable_link_test.cpp
+
+HEADERS += \
+    $$PWD/reliable_link.h \
+    $$PWD/reliable_link_test.h
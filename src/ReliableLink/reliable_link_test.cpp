@@ -0,0 +1,501 @@
+// TEST: g++ -O2 -Wall -Wextra -I../TestUtil -I../FrameCodec -DRELIABLE_LINK_TEST_MAIN ../FrameCodec/crc8.cpp ../FrameCodec/frame_codec.cpp reliable_link.cpp reliable_link_test.cpp -o reliable_link_test && ./reliable_link_test
+#include "reliable_link_test.h"
+#include "reliable_link.h"
+#include "frame_codec.h"
+#include "test_util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static inline uint8_t pattern(uint32_t id, uint32_t pos)
+{
+    return static_cast<uint8_t>((id * 31U) ^ pos);
+}
+
+static inline int payloadLen(uint32_t id)
+{
+    return 4 + static_cast<int>((id * 13U) % (RELIABLE_LINK_MAX_PAYLOAD - 3));
+}
+
+// payload: {id >> 24}{id >> 16}{id >> 8}{id}{pattern ...}
+static int makePayload(uint32_t id, uint8_t* out)
+{
+    const int len = payloadLen(id);
+    out[0] = static_cast<uint8_t>(id >> 24);
+    out[1] = static_cast<uint8_t>(id >> 16);
+    out[2] = static_cast<uint8_t>(id >> 8);
+    out[3] = static_cast<uint8_t>(id);
+    for (int i = 4; i < len; ++i) {
+        out[i] = pattern(id, i);
+    }
+    return len;
+}
+
+// returns id or -1 if payload is broken
+static long checkPayload(int len, const uint8_t* data)
+{
+    if (len < 4) {
+        return -1;
+    }
+    const uint32_t id = (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+                        (static_cast<uint32_t>(data[2]) << 8) | data[3];
+    if (len != payloadLen(id)) {
+        return -1;
+    }
+    for (int i = 4; i < len; ++i) {
+        if (data[i] != pattern(id, i)) {
+            return -1;
+        }
+    }
+    return static_cast<long>(id);
+}
+
+
+// in memory link pair with fake clock ----------------------------------------
+struct Wire
+{
+    std::vector<std::vector<uint8_t> > frames;
+    int dropNext = 0;   // drop count of next frames
+
+    void put(int len, const uint8_t* data)
+    {
+        if (dropNext > 0) {
+            --dropNext;
+            return;
+        }
+        frames.push_back(std::vector<uint8_t>(data, data + len));
+    }
+
+    // move all frames to link
+    void deliver(ReliableLink& link)
+    {
+        std::vector<std::vector<uint8_t> > now;
+        now.swap(frames);
+        for (size_t i = 0; i < now.size(); ++i) {
+            link.input(static_cast<int>(now[i].size()), now[i].data());
+        }
+    }
+};
+
+struct Pair
+{
+    ReliableLink a{fakeClock};
+    ReliableLink b{fakeClock};
+    Wire ab;
+    Wire ba;
+    std::vector<long> received;   // ids delivered by b
+
+    Pair()
+    {
+        a.output([this](int len, uint8_t* data) { ab.put(len, data); });
+        b.output([this](int len, uint8_t* data) { ba.put(len, data); });
+        b.on([this](int len, uint8_t* data) { received.push_back(checkPayload(len, data)); });
+    }
+
+    bool send(uint32_t id)
+    {
+        uint8_t payload[RELIABLE_LINK_MAX_PAYLOAD];
+        int len = makePayload(id, payload);
+        return a.send(len, payload);
+    }
+
+    void step(uint32_t ms)
+    {
+        fakeTime() += ms;
+        a.poll();
+        b.poll();
+        ab.deliver(b);
+        ba.deliver(a);
+    }
+};
+
+static void testInOrder(void)
+{
+    Pair pair;
+    for (uint32_t id = 0; id < 100; ++id) {
+        TEST_ASSERT("in order: send", pair.send(id));
+        pair.step(1);
+    }
+
+    bool ok = pair.received.size() == 100;
+    for (size_t i = 0; ok && i < pair.received.size(); ++i) {
+        ok = pair.received[i] == static_cast<long>(i);
+    }
+    TEST_ASSERT("in order: all frames delivered once in order", ok);
+    TEST_ASSERT("in order: nothing in flight", pair.a.inFlight() == 0);
+    TEST_ASSERT("in order: no retransmits", pair.a.stats().retransmits == 0 && pair.a.stats().fastRetransmits == 0);
+    TEST_ASSERT("in order: RTT measured", pair.a.stats().srttMs >= 1 && pair.a.stats().rtoMs >= RELIABLE_LINK_RTO_MIN_MS);
+}
+
+static void testWindowFull(void)
+{
+    Pair pair;
+    for (uint32_t id = 0; id < RELIABLE_LINK_WINDOW; ++id) {
+        TEST_ASSERT("window: send", pair.send(id));
+    }
+    TEST_ASSERT("window: full window rejects", !pair.send(RELIABLE_LINK_WINDOW) && pair.a.stats().windowFull == 1);
+
+    pair.step(1);
+    TEST_ASSERT("window: ACK opens window", pair.a.inFlight() == 0 && pair.send(RELIABLE_LINK_WINDOW));
+}
+
+static void testTimeoutRetransmit(void)
+{
+    Pair pair;
+    pair.send(0);
+    pair.step(1); // measure RTT
+
+    pair.ab.dropNext = 1;
+    pair.send(1);
+    pair.step(1);
+    TEST_ASSERT("timeout: lost frame not delivered", pair.received.size() == 1 && pair.a.inFlight() == 1);
+
+    for (unsigned int i = 0; i < RELIABLE_LINK_RTO_MAX_MS && pair.a.inFlight(); ++i) {
+        pair.step(1);
+    }
+    TEST_ASSERT("timeout: retransmitted and delivered", pair.received.size() == 2 && pair.received[1] == 1);
+    TEST_ASSERT("timeout: retransmit count", pair.a.stats().retransmits == 1);
+}
+
+static void testSelectiveRetransmit(void)
+{
+    Pair pair;
+    pair.send(0);
+    pair.step(1);
+
+    // 1 is lost, 2...5 arrive, SACK shows hole and only 1 is sent again
+    pair.step(5);
+    pair.ab.dropNext = 1;
+    for (uint32_t id = 1; id < 6; ++id) {
+        pair.send(id);
+    }
+    pair.step(5);
+    pair.step(1);
+
+    TEST_ASSERT("sack: frames after hole delivered at once", pair.received.size() == 6);
+    TEST_ASSERT("sack: only missing frame retransmitted", pair.a.stats().fastRetransmits + pair.a.stats().retransmits == 1);
+    TEST_ASSERT("sack: sent frames counted once", pair.a.stats().sent == 6 && pair.b.stats().delivered == 6);
+    TEST_ASSERT("sack: window empty", pair.a.inFlight() == 0);
+}
+
+static void testLostAck(void)
+{
+    Pair pair;
+    pair.send(0);
+    pair.ba.dropNext = 1;   // ACK is lost, frame is sent again
+    for (unsigned int i = 0; i < RELIABLE_LINK_RTO_MAX_MS && pair.a.inFlight(); ++i) {
+        pair.step(1);
+    }
+    TEST_ASSERT("lost ack: delivered once", pair.received.size() == 1 && pair.b.stats().duplicates == 1);
+    TEST_ASSERT("lost ack: acked", pair.a.inFlight() == 0);
+}
+
+static void testGiveUp(void)
+{
+    Pair pair;
+    pair.ab.dropNext = RELIABLE_LINK_MAX_TRIES;
+    pair.send(0);
+    for (unsigned int i = 0; i < RELIABLE_LINK_RTO_MAX_MS * (RELIABLE_LINK_MAX_TRIES + 1) && pair.a.inFlight(); ++i) {
+        pair.step(1);
+    }
+    TEST_ASSERT("give up: frame failed", pair.a.stats().failed == 1 && pair.a.inFlight() == 0);
+    const uint32_t retransmits = pair.a.stats().retransmits;
+
+    // single frame after give up: ACK still points at hole, bitmap acknowledges frame
+    pair.send(1);
+    for (unsigned int i = 0; i < RELIABLE_LINK_RTO_MAX_MS * (RELIABLE_LINK_MAX_TRIES + 1) && pair.a.inFlight(); ++i) {
+        pair.step(1);
+    }
+    TEST_ASSERT("give up: next frame acked by bitmap", pair.received.size() == 1 && pair.a.stats().failed == 1 &&
+                                                       pair.a.stats().retransmits == retransmits);
+
+    // receiver never saw 0, stream goes on past it
+    for (uint32_t id = 2; id < (RELIABLE_LINK_WINDOW * 3); ++id) {
+        pair.send(id);
+        pair.step(1);
+    }
+    TEST_ASSERT("give up: later frames delivered", pair.received.size() == (RELIABLE_LINK_WINDOW * 3 - 1));
+    TEST_ASSERT("give up: receiver skipped hole", pair.b.stats().skipped == 1);
+    TEST_ASSERT("give up: later frames acked once", pair.a.stats().failed == 1 && pair.a.stats().retransmits == retransmits &&
+                                                    pair.a.stats().fastRetransmits == 0 && pair.b.stats().duplicates == 0);
+}
+
+static void testSeqWrap(void)
+{
+    Pair pair;
+    bool ok = true;
+    for (uint32_t id = 0; id < 70000; ++id) {
+        if ((id % 1000) == 500) {
+            pair.ab.dropNext = 1;
+        }
+        ok &= pair.send(id);
+        for (int i = 0; i < 1000 && !pair.a.canSend(); ++i) {
+            pair.step(1);
+        }
+        pair.step(0);
+    }
+    for (unsigned int i = 0; i < RELIABLE_LINK_RTO_MAX_MS && pair.a.inFlight(); ++i) {
+        pair.step(1);
+    }
+    TEST_ASSERT("wrap: all sent", ok);
+    TEST_ASSERT("wrap: 16 bit seq wraps, all delivered once", pair.received.size() == 70000 && pair.b.stats().duplicates == 0);
+}
+
+static void testPeerRestart(void)
+{
+    Pair pair;
+    pair.a.reset(1);
+    for (uint32_t id = 0; id < 1000; ++id) {
+        pair.send(id);
+        pair.step(1);
+    }
+
+    // frame in flight comes late, sender boots again with seq 0 and new epoch
+    pair.send(1000);
+    std::vector<uint8_t> late = pair.ab.frames.back();
+    pair.ab.frames.clear();
+
+    pair.a.reset(2);
+    pair.received.clear();
+    for (uint32_t id = 0; id < 10; ++id) {
+        pair.send(id);
+        pair.step(1);
+    }
+    TEST_ASSERT("restart: new session delivered", pair.received.size() == 10 && pair.received[0] == 0);
+    TEST_ASSERT("restart: no duplicates", pair.b.stats().duplicates == 0 && pair.b.stats().sessions == 1);
+    TEST_ASSERT("restart: window empty", pair.a.inFlight() == 0);
+
+    pair.b.input(static_cast<int>(late.size()), late.data());
+    TEST_ASSERT("restart: late frame of old epoch dropped", pair.received.size() == 10 && pair.b.stats().stale == 1);
+}
+
+static void testReceiverRestart(void)
+{
+    Pair pair;
+    for (uint32_t id = 0; id < 1000; ++id) {
+        pair.send(id);
+        pair.step(1);
+    }
+
+    // receiver boots again, sender goes on with high seq
+    pair.b = ReliableLink(fakeClock);
+    pair.b.output([&pair](int len, uint8_t* data) { pair.ba.put(len, data); });
+    pair.b.on([&pair](int len, uint8_t* data) { pair.received.push_back(checkPayload(len, data)); });
+    pair.received.clear();
+    for (uint32_t id = 0; id < 10; ++id) {
+        pair.send(id);
+        pair.step(1);
+    }
+    TEST_ASSERT("receiver restart: frames delivered", pair.received.size() == 10 && pair.b.stats().duplicates == 0);
+    TEST_ASSERT("receiver restart: window empty", pair.a.inFlight() == 0);
+}
+
+static void testFirstFrameLost(void)
+{
+    Pair pair;
+    pair.a.reset(5);
+    pair.ab.dropNext = 1;
+    pair.send(0);
+    pair.send(1);
+    for (unsigned int i = 0; i < RELIABLE_LINK_RTO_MAX_MS && pair.a.inFlight(); ++i) {
+        pair.step(1);
+    }
+    TEST_ASSERT("first lost: both delivered", pair.received.size() == 2 && pair.b.stats().duplicates == 0);
+}
+
+static void testCoexistence(void)
+{
+    ReliableLink link(fakeClock);
+    uint8_t telemetry[] = {0x01, 0x10, 0x20};
+    TEST_ASSERT("coexist: ordinary command frame is not taken", !link.input(sizeof(telemetry), telemetry));
+}
+
+
+// loopback UDP ---------------------------------------------------------------
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <chrono>
+
+static uint32_t steadyClock(void)
+{
+    using namespace std::chrono;
+    return static_cast<uint32_t>(duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+struct UdpEnd
+{
+    int fd = -1;
+    sockaddr_in peer;
+    unsigned int lossPercent = 0;
+    uint32_t dropped = 0;
+    ReliableLink link{steadyClock};
+    FrameDecoder decoder;
+    uint8_t encoded[FRAME_CODEC_ENCODED_SIZE(FRAME_CODEC_MAX_PAYLOAD)];
+    uint8_t datagram[2048];
+
+    bool open(uint16_t* port)
+    {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t size = sizeof(addr);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &size) < 0) {
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        *port = ntohs(addr.sin_port);
+
+        // one frame per datagram, loss injected before sendto()
+        link.output([this](int len, uint8_t* data) {
+            if (static_cast<unsigned int>(rand() % 100) < lossPercent) {
+                ++dropped;
+                return;
+            }
+            int size = FrameEncoder::encode(len, data, encoded);
+            sendto(fd, encoded, size, 0, reinterpret_cast<sockaddr*>(&peer), sizeof(peer));
+        });
+
+        decoder.on([this](int len, uint8_t* data) {
+            link.input(len, data);
+        });
+        return true;
+    }
+
+    void connectTo(uint16_t port)
+    {
+        memset(&peer, 0, sizeof(peer));
+        peer.sin_family = AF_INET;
+        peer.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        peer.sin_port = htons(port);
+    }
+
+    void proceed()
+    {
+        ssize_t n;
+        while ((n = recv(fd, datagram, sizeof(datagram), 0)) > 0) {
+            decoder.reset();
+            decoder.proceed(datagram, static_cast<int>(n));
+        }
+        link.poll();
+    }
+
+    ~UdpEnd()
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+int reliableLinkLoopbackTest(unsigned int frames, unsigned int lossPercent)
+{
+    int failedBefore = failCount;
+    UdpEnd a, b;
+    uint16_t portA = 0, portB = 0;
+    if (!a.open(&portA) || !b.open(&portB)) {
+        TEST_ASSERT("loopback: sockets", false);
+        return 1;
+    }
+    a.connectTo(portB);
+    b.connectTo(portA);
+    a.lossPercent = b.lossPercent = lossPercent;
+    srand(12345);
+
+    std::vector<uint8_t> seen(frames, 0);
+    bool broken = false;
+    b.link.on([&](int len, uint8_t* data) {
+        long id = checkPayload(len, data);
+        if (id < 0 || id >= static_cast<long>(frames)) {
+            broken = true;
+        } else {
+            ++seen[id];
+        }
+    });
+
+    // unreliable telemetry on same socket, must be ignored by link
+    uint8_t telemetry[] = {0x01, 0x55, 0xAA};
+    uint8_t payload[RELIABLE_LINK_MAX_PAYLOAD];
+    uint32_t next = 0;
+    const uint32_t start = steadyClock();
+
+    while ((next < frames || a.link.inFlight()) && (steadyClock() - start) < 30000U) {
+        while (next < frames && a.link.canSend()) {
+            int len = makePayload(next, payload);
+            a.link.send(len, payload);
+            ++next;
+            int size = FrameEncoder::encode(sizeof(telemetry), telemetry, a.encoded);
+            sendto(a.fd, a.encoded, size, 0, reinterpret_cast<sockaddr*>(&a.peer), sizeof(a.peer));
+        }
+        a.proceed();
+        b.proceed();
+        usleep(100);
+    }
+
+    bool once = true;
+    for (unsigned int i = 0; i < frames; ++i) {
+        once &= seen[i] == 1;
+    }
+
+    const ReliableLinkStats& tx = a.link.stats();
+    printf("loopback %u frames, loss %u%%: %u ms, dropped %u/%u datagrams, retransmits %u (fast %u), srtt %u ms, rto %u ms\n",
+           frames, lossPercent, (unsigned)(steadyClock() - start), (unsigned)a.dropped, (unsigned)b.dropped,
+           (unsigned)tx.retransmits, (unsigned)tx.fastRetransmits, (unsigned)tx.srttMs, (unsigned)tx.rtoMs);
+
+    TEST_ASSERT("loopback: payloads not broken", !broken);
+    TEST_ASSERT("loopback: every frame delivered exactly once", once);
+    TEST_ASSERT("loopback: nothing given up", tx.failed == 0 && b.link.stats().skipped == 0);
+    return failCount - failedBefore;
+}
+#else
+int reliableLinkLoopbackTest(unsigned int, unsigned int)
+{
+    return 0;
+}
+#endif
+
+
+int reliableLinkTest(void)
+{
+    failCount = 0;
+    testInOrder();
+    testWindowFull();
+    testTimeoutRetransmit();
+    testSelectiveRetransmit();
+    testLostAck();
+    testGiveUp();
+    testSeqWrap();
+    testPeerRestart();
+    testReceiverRestart();
+    testFirstFrameLost();
+    testCoexistence();
+
+    if (failCount == 0) {
+        printf("reliable link: all tests passed\n");
+    }
+    return failCount;
+}
+
+
+#ifdef RELIABLE_LINK_TEST_MAIN
+int main(void)
+{
+    int failed = reliableLinkTest();
+    failed += reliableLinkLoopbackTest(2000, 0);
+    failed += reliableLinkLoopbackTest(2000, 10);
+    return failed ? 1 : 0;
+}
+#endif /* RELIABLE_LINK_TEST_MAIN */
@@ -0,0 +1,9 @@
+#ifndef RELIABLE_LINK_TEST_H
+#define RELIABLE_LINK_TEST_H
+
+// returns count of failed checks
+int reliableLinkTest(void);
+// two links over loopback UDP sockets (POSIX hosts only), loss in percent per datagram
+int reliableLinkLoopbackTest(unsigned int frames, unsigned int lossPercent);
+
+#endif /* RELIABLE_LINK_TEST_H */
@@ -0,0 +1,297 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+/*
+ * Lock-free, wait-free single producer / single consumer rings (header only, no heap).
+ *
+ *  SpscByteRing<Capacity>  - byte stream, partial write/read and zero-copy spans
+ *  SpscFrameRing<Capacity> - variable length frames (2 byte length + data, may wrap)
+ *
+ * Capacity is in bytes and must be power of two. Indexes are free running 32 bit
+ * counters, so full/empty need no extra slot. Producer writes only m_head, consumer
+ * writes only m_tail (except SpscFrameRing::pushOverwrite(), see below). Each side
+ * keeps cached copy of other side index on own cache line, shared index is reloaded
+ * only when cached one says ring is full/empty.
+ *
+ * Compiles for ESP32 (xtensa gcc) and host, see spsc_ring_test.cpp for stress test
+ * and benchmark.
+ */
+
+#ifndef SPSC_RING_CACHE_LINE
+#   if defined(ARDUINO) || defined(ESP_PLATFORM)
+#       define SPSC_RING_CACHE_LINE 32
+#   else
+#       define SPSC_RING_CACHE_LINE 64
+#   endif
+#endif /* SPSC_RING_CACHE_LINE */
+
+
+template <uint32_t Capacity>
+class SpscRingBase
+{
+    static_assert(Capacity >= 16 && Capacity <= 0x80000000U && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be power of two");
+
+public:
+    SpscRingBase() : m_head(0), m_tailCache(0), m_highWater(0), m_tail(0), m_headCache(0) {}
+
+    inline bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+    inline uint32_t used() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+    inline uint32_t highWater() const { return m_highWater; }
+    static constexpr uint32_t capacity() { return Capacity; }
+
+protected:
+    static constexpr uint32_t mask = Capacity - 1;
+
+    // producer: free bytes, shared tail is read only if cached one is not enough
+    inline uint32_t _free(uint32_t head, uint32_t need)
+    {
+        uint32_t space = Capacity - (head - m_tailCache);
+        if (space < need) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            space = Capacity - (head - m_tailCache);
+        }
+        return space;
+    }
+
+    // consumer: used bytes, shared head is read only if cached one is not enough
+    // (signed compare: with pushOverwrite() tail may pass stale cached head)
+    inline uint32_t _available(uint32_t tail, uint32_t need)
+    {
+        int32_t avail = static_cast<int32_t>(m_headCache - tail);
+        if (avail < static_cast<int32_t>(need)) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            avail = static_cast<int32_t>(m_headCache - tail);
+        }
+        return avail > 0 ? static_cast<uint32_t>(avail) : 0;
+    }
+
+    inline void _publish(uint32_t head)
+    {
+        m_head.store(head, std::memory_order_release);
+
+        // cached tail may be old, confirm new maximum with real one
+        if ((head - m_tailCache) > m_highWater) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            const uint32_t used = head - m_tailCache;
+            if (used > m_highWater) {
+                m_highWater = used;
+            }
+        }
+    }
+
+    void _copyIn(uint32_t pos, const uint8_t* data, uint32_t len)
+    {
+        const uint32_t idx = pos & mask;
+        const uint32_t first = (Capacity - idx) < len ? (Capacity - idx) : len;
+        memcpy(m_buffer + idx, data, first);
+        memcpy(m_buffer, data + first, len - first);
+    }
+
+    void _copyOut(uint32_t pos, uint8_t* out, uint32_t len) const
+    {
+        const uint32_t idx = pos & mask;
+        const uint32_t first = (Capacity - idx) < len ? (Capacity - idx) : len;
+        memcpy(out, m_buffer + idx, first);
+        memcpy(out + first, m_buffer, len - first);
+    }
+
+    // producer cache line
+    alignas(SPSC_RING_CACHE_LINE) std::atomic<uint32_t> m_head;
+    uint32_t m_tailCache;
+    uint32_t m_highWater;           // max used bytes
+
+    // consumer cache line
+    alignas(SPSC_RING_CACHE_LINE) std::atomic<uint32_t> m_tail;
+    uint32_t m_headCache;
+
+    alignas(SPSC_RING_CACHE_LINE) uint8_t m_buffer[Capacity];
+};
+
+
+// byte stream -----------------------------------------------------------------------
+template <uint32_t Capacity>
+class SpscByteRing : public SpscRingBase<Capacity>
+{
+    typedef SpscRingBase<Capacity> Base;
+
+public:
+    // producer: copy up to len bytes, returns bytes written
+    uint32_t write(const uint8_t* data, uint32_t len)
+    {
+        const uint32_t head = Base::m_head.load(std::memory_order_relaxed);
+        const uint32_t space = Base::_free(head, len);
+        if (len > space) {
+            len = space;
+        }
+
+        if (len) {
+            Base::_copyIn(head, data, len);
+            Base::_publish(head + len);
+        }
+        return len;
+    }
+
+    // producer, zero-copy: contiguous free space at *ptr, fill it and call commit()
+    uint32_t writeSpan(uint8_t** ptr)
+    {
+        const uint32_t head = Base::m_head.load(std::memory_order_relaxed);
+        const uint32_t idx = head & Base::mask;
+        const uint32_t space = Base::_free(head, Capacity - idx);
+        *ptr = Base::m_buffer + idx;
+        return space < (Capacity - idx) ? space : (Capacity - idx);
+    }
+
+    void commit(uint32_t len)
+    {
+        Base::_publish(Base::m_head.load(std::memory_order_relaxed) + len);
+    }
+
+    // consumer: copy up to len bytes, returns bytes read
+    uint32_t read(uint8_t* out, uint32_t len)
+    {
+        const uint32_t tail = Base::m_tail.load(std::memory_order_relaxed);
+        const uint32_t avail = Base::_available(tail, len);
+        if (len > avail) {
+            len = avail;
+        }
+
+        if (len) {
+            Base::_copyOut(tail, out, len);
+            Base::m_tail.store(tail + len, std::memory_order_release);
+        }
+        return len;
+    }
+
+    // consumer, zero-copy: contiguous readable bytes at *ptr, use them and call consume()
+    uint32_t readSpan(const uint8_t** ptr)
+    {
+        const uint32_t tail = Base::m_tail.load(std::memory_order_relaxed);
+        const uint32_t idx = tail & Base::mask;
+        const uint32_t avail = Base::_available(tail, Capacity - idx);
+        *ptr = Base::m_buffer + idx;
+        return avail < (Capacity - idx) ? avail : (Capacity - idx);
+    }
+
+    void consume(uint32_t len)
+    {
+        Base::m_tail.store(Base::m_tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+};
+
+
+/*
+ * Frames. Drop policy is selected by producer call:
+ *  push()          - drop newest: returns false if frame does not fit
+ *  pushOverwrite() - drop oldest: moves m_tail forward by CAS until frame fits,
+ *                    consumer must use pop() (copy + CAS commit) in this mode
+ */
+template <uint32_t Capacity>
+class SpscFrameRing : public SpscRingBase<Capacity>
+{
+    typedef SpscRingBase<Capacity> Base;
+
+public:
+    static constexpr uint32_t header = 2;
+    static constexpr uint32_t maxFrame = (Capacity - header) > 0xFFFF ? 0xFFFF : (Capacity - header);
+
+    // producer side ---------------------------------------------------------
+    bool push(const uint8_t* data, uint32_t len)
+    {
+        if (len > maxFrame) {
+            return false;
+        }
+
+        const uint32_t head = Base::m_head.load(std::memory_order_relaxed);
+        if (Base::_free(head, header + len) < (header + len)) {
+            return false;
+        }
+
+        _write(head, data, len);
+        return true;
+    }
+
+    // returns false only if frame can never fit, dropped counts removed old frames
+    bool pushOverwrite(const uint8_t* data, uint32_t len, uint32_t* dropped = nullptr)
+    {
+        if (len > maxFrame) {
+            return false;
+        }
+
+        const uint32_t head = Base::m_head.load(std::memory_order_relaxed);
+        uint32_t tail = Base::m_tail.load(std::memory_order_acquire);
+
+        while ((Capacity - (head - tail)) < (header + len)) {
+            const uint32_t next = tail + header + _readLen(tail);
+            // consumer may commit same frame at same time, both results are fine
+            if (Base::m_tail.compare_exchange_weak(tail, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                tail = next;
+                if (dropped) {
+                    ++(*dropped);
+                }
+            }
+        }
+
+        Base::m_tailCache = tail;
+        _write(head, data, len);
+        return true;
+    }
+
+    // consumer side ---------------------------------------------------------
+    // copy oldest frame to out, returns frame len or -1 if ring is empty (frames bigger than outSize are skipped)
+    int pop(uint8_t* out, uint32_t outSize)
+    {
+        uint32_t tail = Base::m_tail.load(std::memory_order_acquire);
+
+        while (true) {
+            if (Base::_available(tail, header) == 0) {
+                return -1;
+            }
+
+            // len may be garbage if frame was just dropped by producer, CAS below rejects it
+            const uint32_t len = _readLen(tail);
+            const bool fits = len <= outSize && len <= maxFrame;
+            if (fits) {
+                Base::_copyOut(tail + header, out, len);
+            }
+
+            // commit, fails only if producer dropped this frame (pushOverwrite) while we were copying
+            if (Base::m_tail.compare_exchange_strong(tail, tail + header + len, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                if (fits) {
+                    return static_cast<int>(len);
+                }
+                tail += header + len;
+            }
+        }
+    }
+
+    // len of oldest frame without taking it, or -1 if ring is empty (consumer can check
+    // space on its output first); with pushOverwrite() frame may be dropped before pop()
+    int peekLen()
+    {
+        const uint32_t tail = Base::m_tail.load(std::memory_order_acquire);
+        if (Base::_available(tail, header) == 0) {
+            return -1;
+        }
+        return static_cast<int>(_readLen(tail));
+    }
+
+private:
+    void _write(uint32_t head, const uint8_t* data, uint32_t len)
+    {
+        Base::m_buffer[head & Base::mask] = static_cast<uint8_t>(len >> 8);
+        Base::m_buffer[(head + 1) & Base::mask] = static_cast<uint8_t>(len);
+        Base::_copyIn(head + header, data, len);
+        Base::_publish(head + header + len);
+    }
+
+    inline uint32_t _readLen(uint32_t pos) const
+    {
+        return (static_cast<uint32_t>(Base::m_buffer[pos & Base::mask]) << 8) | Base::m_buffer[(pos + 1) & Base::mask];
+    }
+};
+
+#endif /* SPSC_RING_H */
@@ -0,0 +1,9 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD	
+
+SOURCES += \
+    $$PWD/spsc_ring_test.cpp
+
+HEADERS += \
+    $$PWD/spsc_ring.h \
+    $$PWD/spsc_ring_test.h
@@ -0,0 +1,395 @@
+// TEST: g++ -O2 -Wall -Wextra -I../TestUtil -pthread -DSPSC_RING_TEST_MAIN spsc_ring_test.cpp -o spsc_ring_test && ./spsc_ring_test
+#include "spsc_ring_test.h"
+#include "spsc_ring.h"
+#include "test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifndef SPSC_RING_STRESS_COUNT
+#   ifdef ARDUINO
+#       define SPSC_RING_STRESS_COUNT 20000U
+#   else
+#       define SPSC_RING_STRESS_COUNT 2000000U
+#   endif
+#endif /* SPSC_RING_STRESS_COUNT */
+
+// pattern of frame/stream byte, depends on sequence number and position
+static inline uint8_t pattern(uint32_t seq, uint32_t pos)
+{
+    return static_cast<uint8_t>((seq * 31U) ^ pos);
+}
+
+static inline uint32_t frameLen(uint32_t seq)
+{
+    return (seq * 7U) % 301U;
+}
+
+static SpscByteRing<64> smallBytes;
+static SpscFrameRing<64> smallFrames;
+static SpscFrameRing<64> smallOverwrite;
+static SpscByteRing<4096> stressBytes;
+static SpscFrameRing<4096> stressFrames;
+static SpscFrameRing<1024> stressOverwrite;
+
+
+// single thread tests --------------------------------------------------------
+static void testByteRing(void)
+{
+    uint8_t in[100], out[100];
+    for (int i = 0; i < 100; ++i) {
+        in[i] = static_cast<uint8_t>(i);
+    }
+
+    TEST_ASSERT("byte ring starts empty", smallBytes.empty() && smallBytes.read(out, 10) == 0);
+    TEST_ASSERT("byte ring partial write", smallBytes.write(in, 100) == 64);
+    TEST_ASSERT("byte ring full", smallBytes.write(in, 1) == 0);
+    TEST_ASSERT("byte ring high water", smallBytes.highWater() == 64);
+
+    // wrap around many times with odd sizes
+    uint32_t wr = 0, rd = 0;
+    bool ok = true;
+    TEST_ASSERT("byte ring read", smallBytes.read(out, 64) == 64 && memcmp(in, out, 64) == 0);
+    for (int round = 0; round < 1000; ++round) {
+        uint8_t chunk[37];
+        for (uint32_t i = 0; i < sizeof(chunk); ++i) {
+            chunk[i] = pattern(0, wr + i);
+        }
+        wr += smallBytes.write(chunk, (round % 37) + 1);
+
+        uint32_t n = smallBytes.read(out, (round % 23) + 1);
+        for (uint32_t i = 0; i < n; ++i) {
+            ok &= out[i] == pattern(0, rd + i);
+        }
+        rd += n;
+    }
+    TEST_ASSERT("byte ring wrap around keeps order", ok && smallBytes.used() == (wr - rd));
+
+    // zero-copy spans
+    const uint8_t* rptr;
+    uint32_t n;
+    while ((n = smallBytes.readSpan(&rptr)) != 0) {
+        smallBytes.consume(n);
+    }
+    uint8_t* wptr;
+    n = smallBytes.writeSpan(&wptr);
+    TEST_ASSERT("byte ring write span", n > 0 && n <= 64);
+    memset(wptr, 0xA5, n);
+    smallBytes.commit(n);
+    TEST_ASSERT("byte ring read span", smallBytes.readSpan(&rptr) == n && rptr[0] == 0xA5 && rptr[n - 1] == 0xA5);
+    smallBytes.consume(n);
+    TEST_ASSERT("byte ring empty after spans", smallBytes.empty());
+}
+
+static void testFrameRing(void)
+{
+    uint8_t in[64], out[64];
+    for (int i = 0; i < 64; ++i) {
+        in[i] = static_cast<uint8_t>(i);
+    }
+
+    TEST_ASSERT("frame ring starts empty", smallFrames.pop(out, sizeof(out)) == -1);
+    TEST_ASSERT("frame ring rejects too big frame", !smallFrames.push(in, 63));
+    TEST_ASSERT("empty frame", smallFrames.push(in, 0) && smallFrames.pop(out, sizeof(out)) == 0);
+    TEST_ASSERT("peek empty ring", smallFrames.peekLen() == -1);
+    TEST_ASSERT("peek keeps frame", smallFrames.push(in, 7) && smallFrames.peekLen() == 7 && smallFrames.peekLen() == 7);
+    TEST_ASSERT("peek then pop", smallFrames.pop(out, sizeof(out)) == 7 && smallFrames.peekLen() == -1);
+
+    bool ok = true;
+    for (uint32_t seq = 0; seq < 1000; ++seq) {
+        const uint32_t len = seq % 20;
+        for (uint32_t i = 0; i < len; ++i) {
+            in[i] = pattern(seq, i);
+        }
+        ok &= smallFrames.push(in, len);
+
+        int n = smallFrames.pop(out, sizeof(out));
+        ok &= n == static_cast<int>(len);
+        for (uint32_t i = 0; i < len; ++i) {
+            ok &= out[i] == pattern(seq, i);
+        }
+    }
+    TEST_ASSERT("frame ring wrap around keeps frames", ok);
+
+    // drop newest
+    TEST_ASSERT("frame ring fill", smallFrames.push(in, 30) && smallFrames.push(in, 30));
+    TEST_ASSERT("frame ring drop newest", !smallFrames.push(in, 1));
+    while (smallFrames.pop(out, sizeof(out)) >= 0) {}
+
+    // drop oldest
+    uint32_t dropped = 0;
+    for (uint32_t seq = 0; seq < 10; ++seq) {
+        in[0] = static_cast<uint8_t>(seq);
+        smallOverwrite.pushOverwrite(in, 20, &dropped);
+    }
+    TEST_ASSERT("frame ring drop oldest count", dropped == 8);
+    TEST_ASSERT("frame ring drop oldest keeps newest", smallOverwrite.pop(out, sizeof(out)) == 20 && out[0] == 8);
+    TEST_ASSERT("frame ring drop oldest keeps newest 2", smallOverwrite.pop(out, sizeof(out)) == 20 && out[0] == 9);
+
+    // too small output buffer: frame is skipped
+    smallFrames.push(in, 10);
+    smallFrames.push(in, 3);
+    TEST_ASSERT("frame ring skips frame bigger than output", smallFrames.pop(out, 5) == 3 && smallFrames.empty());
+}
+
+
+// multi thread stress ---------------------------------------------------------
+static void stressByteRing(void)
+{
+    const uint32_t total = SPSC_RING_STRESS_COUNT * 16U;
+    std::atomic<bool> ok(true);
+
+    std::thread producer([&]() {
+        uint8_t chunk[523];
+        uint32_t pos = 0;
+        while (pos < total) {
+            uint32_t n = static_cast<uint32_t>(sizeof(chunk)) < (total - pos) ? static_cast<uint32_t>(sizeof(chunk)) : (total - pos);
+            for (uint32_t i = 0; i < n; ++i) {
+                chunk[i] = pattern(1, pos + i);
+            }
+            uint32_t w = stressBytes.write(chunk, n);
+            pos += w;
+            if (w < n) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread consumer([&]() {
+        uint32_t pos = 0;
+        while (pos < total) {
+            const uint8_t* ptr;
+            uint32_t n = stressBytes.readSpan(&ptr);
+            if (!n) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (uint32_t i = 0; i < n; ++i) {
+                if (ptr[i] != pattern(1, pos + i)) {
+                    ok = false;
+                }
+            }
+            stressBytes.consume(n);
+            pos += n;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    TEST_ASSERT("byte ring stress: stream must be intact", ok && stressBytes.empty());
+}
+
+static void stressFrameRing(void)
+{
+    const uint32_t total = SPSC_RING_STRESS_COUNT;
+    std::atomic<bool> ok(true);
+
+    std::thread producer([&]() {
+        uint8_t frame[301];
+        for (uint32_t seq = 0; seq < total; ) {
+            const uint32_t len = frameLen(seq);
+            for (uint32_t i = 0; i < len; ++i) {
+                frame[i] = pattern(seq, i);
+            }
+            if (stressFrames.push(frame, len)) {
+                ++seq;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread consumer([&]() {
+        uint8_t frame[301];
+        for (uint32_t seq = 0; seq < total; ) {
+            int len = stressFrames.pop(frame, sizeof(frame));
+            if (len < 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (static_cast<uint32_t>(len) != frameLen(seq)) {
+                ok = false;
+            }
+            for (int i = 0; i < len; ++i) {
+                if (frame[i] != pattern(seq, i)) {
+                    ok = false;
+                }
+            }
+            ++seq;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    TEST_ASSERT("frame ring stress: frames must be intact and in order", ok && stressFrames.empty());
+}
+
+static void stressFrameRingOverwrite(void)
+{
+    // frame = {seq (4 bytes)}{pattern}, consumer must see increasing seq and intact payload
+    const uint32_t total = SPSC_RING_STRESS_COUNT;
+    std::atomic<bool> ok(true);
+    std::atomic<bool> done(false);
+    uint32_t dropped = 0;
+    uint32_t received = 0;
+
+    std::thread producer([&]() {
+        uint8_t frame[4 + 301];
+        for (uint32_t seq = 0; seq < total; ++seq) {
+            const uint32_t len = frameLen(seq);
+            memcpy(frame, &seq, 4);
+            for (uint32_t i = 0; i < len; ++i) {
+                frame[4 + i] = pattern(seq, i);
+            }
+            stressOverwrite.pushOverwrite(frame, 4 + len, &dropped);
+            if ((seq & 0xFF) == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+    });
+
+    std::thread consumer([&]() {
+        uint8_t frame[4 + 301];
+        uint32_t last = 0;
+        bool first = true;
+        while (true) {
+            int len = stressOverwrite.pop(frame, sizeof(frame));
+            if (len < 0) {
+                if (done) {
+                    break;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+
+            uint32_t seq;
+            memcpy(&seq, frame, 4);
+            if ((!first && seq <= last) || static_cast<uint32_t>(len) != 4 + frameLen(seq)) {
+                ok = false;
+                continue;
+            }
+            for (int i = 4; i < len; ++i) {
+                if (frame[i] != pattern(seq, i - 4)) {
+                    ok = false;
+                }
+            }
+            first = false;
+            last = seq;
+            ++received;
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    TEST_ASSERT("overwrite stress: received frames must be intact and in order", ok);
+    TEST_ASSERT("overwrite stress: every frame is received or dropped", (received + dropped) == total);
+}
+
+int spscRingTest(void)
+{
+    failCount = 0;
+
+    testByteRing();
+    testFrameRing();
+    stressByteRing();
+    stressFrameRing();
+    stressFrameRingOverwrite();
+
+    printf("spsc ring test: %s (%d failed)\n", failCount ? "FAILED" : "OK", failCount);
+    return failCount;
+}
+
+
+// benchmark ------------------------------------------------------------------
+static double elapsedSec(std::chrono::steady_clock::time_point from)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - from).count();
+}
+
+static SpscByteRing<16384> benchBytes;
+static SpscFrameRing<16384> benchFrames;
+
+static void benchmarkBytes(uint32_t chunkSize)
+{
+    const uint32_t total = SPSC_RING_STRESS_COUNT * 64U;
+    uint8_t chunk[1024] = {0};
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&]() {
+        for (uint32_t pos = 0; pos < total; ) {
+            uint32_t w = benchBytes.write(chunk, chunkSize);
+            pos += w;
+            if (!w) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint8_t out[1024];
+    for (uint32_t pos = 0; pos < total; ) {
+        uint32_t r = benchBytes.read(out, sizeof(out));
+        pos += r;
+        if (!r) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    double sec = elapsedSec(start);
+
+    while (benchBytes.read(out, sizeof(out))) {}
+    printf("byte ring  chunk %4u: %9.2f MB/s\n", (unsigned)chunkSize, (total / (1024.0 * 1024.0)) / sec);
+}
+
+static void benchmarkFrames(uint32_t frameSize)
+{
+    const uint32_t total = SPSC_RING_STRESS_COUNT;
+    uint8_t frame[1024] = {0};
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&]() {
+        for (uint32_t seq = 0; seq < total; ) {
+            if (benchFrames.push(frame, frameSize)) {
+                ++seq;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint8_t out[1024];
+    for (uint32_t seq = 0; seq < total; ) {
+        if (benchFrames.pop(out, sizeof(out)) >= 0) {
+            ++seq;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    double sec = elapsedSec(start);
+
+    printf("frame ring frame %4u: %9.2f Mframes/s, %9.2f MB/s\n", (unsigned)frameSize,
+           (total / 1e6) / sec, (static_cast<double>(total) * frameSize / (1024.0 * 1024.0)) / sec);
+}
+
+void spscRingBenchmark(void)
+{
+    benchmarkBytes(64);
+    benchmarkBytes(1024);
+    benchmarkFrames(16);
+    benchmarkFrames(256);
+    benchmarkFrames(1024);
+}
+
+
+#ifdef SPSC_RING_TEST_MAIN
+int main(void)
+{
+    int failed = spscRingTest();
+    spscRingBenchmark();
+    return failed ? 1 : 0;
+}
+#endif /* SPSC_RING_TEST_MAIN */
@@ -0,0 +1,8 @@
+#ifndef SPSC_RING_TEST_H
+#define SPSC_RING_TEST_H
+
+// returns count of failed checks
+int spscRingTest(void);
+void spscRingBenchmark(void);
+
+#endif /* SPSC_RING_TEST_H */
@@ -0,0 +1,182 @@
+#include "store_forward.h"
+#include "convert.h"
+#include <string.h>
+
+
+StoreForward::StoreForward(Clock clock) :
+    m_clock(clock)
+{
+
+}
+
+void StoreForward::output(Output out)
+{
+    m_output = out;
+}
+
+void StoreForward::ready(std::function<bool(int len)> foo)
+{
+    m_ready = foo;
+}
+
+void StoreForward::setReplayRate(uint32_t bytesPerSec)
+{
+    m_rate = bytesPerSec;
+    m_tokens = 0;
+    m_refillTime = m_clock();
+}
+
+StoreForwardStats StoreForward::stats() const
+{
+    StoreForwardStats stats = m_stats;
+    stats.ramHighWater = m_ram.highWater();
+    return stats;
+}
+
+
+// frames -----------------------------------------------------------------------------
+bool StoreForward::write(int len, uint8_t* data)
+{
+    if (len < 0 || len > FRAME_CODEC_MAX_PAYLOAD) {
+        ++m_stats.droppedNewest;
+        return false;
+    }
+
+    // older frames go first
+    proceed();
+
+    if (m_linkUp && empty() && m_output && (!m_ready || m_ready(len))) {
+        m_frameTime = m_clock();
+        m_frameStored = false;
+        m_output(len, data);
+        ++m_stats.passed;
+        return true;
+    }
+
+    const uint32_t entryLen = STORE_FORWARD_TIME_SIZE + len;
+    if (!_makeRoom(entryLen)) {
+        ++m_stats.droppedNewest;
+        return false;
+    }
+
+    unsigned int pos = 0;
+    Convert::FB::writeU32(m_entry, &pos, m_clock());
+    memcpy(m_entry + pos, data, len);
+    m_ram.push(m_entry, entryLen);
+    ++m_stats.stored;
+    return true;
+}
+
+// free RAM for entry: oldest entries go to log or are dropped by policy
+bool StoreForward::_makeRoom(uint32_t len)
+{
+    while ((m_ram.capacity() - m_ram.used()) < (Ram::header + len)) {
+        if (m_log && m_log->fits(STORE_FORWARD_ENTRY_MAX)) {
+            const int oldest = m_ram.pop(m_entry, sizeof(m_entry));
+            if (oldest < 0) {
+                return false;
+            }
+            if (m_log->append(m_entry, oldest)) {
+                ++m_stats.spilled;
+                if (m_log->used() > m_stats.logHighWater) {
+                    m_stats.logHighWater = m_log->used();
+                }
+            } else {
+                ++m_stats.droppedOldest; // log write failed
+            }
+            continue;
+        }
+
+        if (m_policy != STORE_DROP_OLDEST || m_ram.pop(m_entry, sizeof(m_entry)) < 0) {
+            return false;
+        }
+        ++m_stats.droppedOldest;
+    }
+    return true;
+}
+
+void StoreForward::proceed()
+{
+    if (!m_linkUp || !m_output) {
+        return;
+    }
+
+    const uint32_t now = m_clock();
+    _refill(now);
+
+    while (_next()) {
+        const uint8_t* frame = m_pending + STORE_FORWARD_TIME_SIZE;
+        const int len = m_pendingLen - STORE_FORWARD_TIME_SIZE;
+
+        unsigned int pos = 0;
+        const uint32_t time = Convert::FB::readU32(m_pending, &pos);
+        if (m_retentionMs && (now - time) > m_retentionMs) {
+            ++m_stats.expired;
+            m_pendingLen = -1;
+            continue;
+        }
+
+        if (m_rate && m_tokens < static_cast<uint32_t>(len)) {
+            ++m_stats.rateWaits;
+            return;
+        }
+
+        if (m_ready && !m_ready(len)) {
+            return;
+        }
+
+        m_pendingLen = -1;
+        if (m_rate) {
+            m_tokens -= len;
+        }
+        m_frameTime = time;
+        m_frameStored = true;
+        m_output(len, const_cast<uint8_t*>(frame));
+        ++m_stats.replayed;
+    }
+}
+
+// oldest entry to m_pending: log first, then RAM
+bool StoreForward::_next()
+{
+    if (m_pendingLen >= 0) {
+        return true;
+    }
+
+    if (m_log && m_log->used()) {
+        m_pendingLen = m_log->read(m_pending, sizeof(m_pending));
+    }
+    if (m_pendingLen < 0) {
+        m_pendingLen = m_ram.pop(m_pending, sizeof(m_pending));
+    }
+
+    // entry without time is garbage
+    if (m_pendingLen >= 0 && m_pendingLen < STORE_FORWARD_TIME_SIZE) {
+        m_pendingLen = -1;
+        return _next();
+    }
+    return m_pendingLen >= 0;
+}
+
+void StoreForward::_refill(uint32_t now)
+{
+    if (!m_rate) {
+        return;
+    }
+
+    // burst is limited to 100 ms of rate, but one max frame must always fit
+    uint32_t burst = m_rate / 10U;
+    if (burst < FRAME_CODEC_MAX_PAYLOAD) {
+        burst = FRAME_CODEC_MAX_PAYLOAD;
+    }
+
+    // time is taken only when it gave at least one byte, slow rates still accumulate
+    const uint64_t added = static_cast<uint64_t>(now - m_refillTime) * m_rate / 1000U;
+    if (added == 0) {
+        return;
+    }
+
+    const uint64_t tokens = m_tokens + added;
+    m_tokens = tokens > burst ? burst : static_cast<uint32_t>(tokens);
+    m_refillTime = now;
+}
@@ -0,0 +1,136 @@
+#ifndef STORE_FORWARD_H
+#define STORE_FORWARD_H
+
+#include <stdint.h>
+#include <functional>
+#include "frame_codec.h"
+#include "spsc_ring.h"
+
+/*
+ * Store-and-forward for one direction of bridge while link is down (platform independent).
+ *
+ *  link up, nothing stored : write() -> output() at once
+ *  link down or replaying  : write() -> [RAM ring] -> spill oldest -> [log] (optional, flash)
+ *  link up                 : proceed() replays log first, then RAM, in write order
+ *
+ * Every stored entry is {write time ms u32 BE}{frame}. Log holds entries older than RAM,
+ * when RAM is full its oldest entry is appended to log. Without log (or when log is full)
+ * policy decides:
+ *  STORE_DROP_NEWEST - new frame is dropped
+ *  STORE_DROP_OLDEST - oldest RAM entry is dropped
+ *
+ * Replay: entries older than retention are skipped, replay rate is limited to setReplayRate()
+ * bytes/sec (0 -> link speed), ready() tells if transport can take frame now (backpressure,
+ * e.g. TCP TX queue space), entry that can not go now waits for next proceed().
+ */
+
+#ifndef STORE_FORWARD_RAM_SIZE
+#   define STORE_FORWARD_RAM_SIZE 16384U   // bytes (power of two), every entry takes 2 + 4 bytes + frame
+#endif /* STORE_FORWARD_RAM_SIZE */
+
+#define STORE_FORWARD_TIME_SIZE 4
+#define STORE_FORWARD_ENTRY_MAX (STORE_FORWARD_TIME_SIZE + FRAME_CODEC_MAX_PAYLOAD)
+
+static_assert(STORE_FORWARD_ENTRY_MAX <= SpscFrameRing<STORE_FORWARD_RAM_SIZE>::maxFrame, "STORE_FORWARD_RAM_SIZE too small for one frame");
+
+enum StorePolicy
+{
+    STORE_DROP_NEWEST = 0,
+    STORE_DROP_OLDEST
+};
+
+// append-only entry log, e.g. file on flash partition
+class StoreForwardLog
+{
+public:
+    virtual ~StoreForwardLog() {}
+
+    // true if entry of len bytes can be appended now
+    virtual bool fits(uint32_t len) const = 0;
+    virtual bool append(const uint8_t* data, uint32_t len) = 0;
+    // next entry in append order to out, returns its len or -1 if log is empty
+    virtual int read(uint8_t* out, uint32_t size) = 0;
+    virtual uint32_t used() const = 0;
+    virtual void clear() = 0;
+};
+
+struct StoreForwardStats
+{
+    uint32_t passed = 0;        // frames sent at once (link up, nothing stored)
+    uint32_t stored = 0;        // frames stored while link was down
+    uint32_t spilled = 0;       // entries moved from RAM to log
+    uint32_t replayed = 0;
+    uint32_t expired = 0;       // skipped on replay, older than retention
+    uint32_t droppedNewest = 0;
+    uint32_t droppedOldest = 0;
+    uint32_t rateWaits = 0;     // replay stopped by rate limit
+    uint32_t ramHighWater = 0;  // bytes
+    uint32_t logHighWater = 0;  // bytes
+};
+
+class StoreForward
+{
+public:
+    typedef uint32_t (*Clock)(void);
+    typedef std::function<void(int len, uint8_t* data)> Output;
+
+    StoreForward(Clock clock);
+
+    void output(Output out);
+    void ready(std::function<bool(int len)> foo);
+    inline void setLog(StoreForwardLog* log) {m_log = log;}
+
+    inline void setPolicy(StorePolicy policy) {m_policy = policy;}
+    // 0 -> entries never expire
+    inline void setRetention(uint32_t ms) {m_retentionMs = ms;}
+    // 0 -> replay at link speed
+    void setReplayRate(uint32_t bytesPerSec);
+
+    // link state, replay starts on next proceed() after link is up
+    inline void setLink(bool up) {m_linkUp = up;}
+    inline bool linkUp() const {return m_linkUp;}
+
+    // returns false if frame was dropped
+    bool write(int len, uint8_t* data);
+    // replay stored frames while link is up
+    void proceed();
+
+    // for output() handler: clock() when frame came to write(), and if it waited in store
+    inline uint32_t frameTime() const {return m_frameTime;}
+    inline bool frameStored() const {return m_frameStored;}
+
+    inline bool empty() const {return m_pendingLen < 0 && m_ram.empty() && !(m_log && m_log->used());}
+    inline uint32_t storedBytes() const {return m_ram.used() + (m_log ? m_log->used() : 0);}
+    StoreForwardStats stats() const;
+
+private:
+    typedef SpscFrameRing<STORE_FORWARD_RAM_SIZE> Ram;
+
+    bool _makeRoom(uint32_t len);
+    bool _next();
+    void _refill(uint32_t now);
+
+    Clock m_clock;
+    Output m_output = nullptr;
+    std::function<bool(int len)> m_ready = nullptr;
+    StoreForwardLog* m_log = nullptr;
+
+    StorePolicy m_policy = STORE_DROP_OLDEST;
+    uint32_t m_retentionMs = 0;
+    bool m_linkUp = false;
+
+    uint32_t m_rate = 0;        // bytes/sec
+    uint32_t m_tokens = 0;      // bytes allowed now
+    uint32_t m_refillTime = 0;
+
+    Ram m_ram;
+    uint8_t m_entry[STORE_FORWARD_ENTRY_MAX];   // new entry / RAM -> log move
+    uint8_t m_pending[STORE_FORWARD_ENTRY_MAX]; // oldest entry, taken out but not sent yet
+    int m_pendingLen = -1;
+    uint32_t m_frameTime = 0;   // frame now in output()
+    bool m_frameStored = false;
+
+    StoreForwardStats m_stats;
+};
+
+#endif /* STORE_FORWARD_H */
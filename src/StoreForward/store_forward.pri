@@ -0,0 +1,10 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD	
+
+SOURCES += \
+    $$PWD/store_forward.cpp \
+    $$PWD/store_forward_test.cpp
+
+HEADERS += \
+    $$PWD/store_forward.h \
+    $$PWD/store_forward_test.h
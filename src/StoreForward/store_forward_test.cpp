@@ -0,0 +1,300 @@
+// TEST: g++ -O2 -Wall -Wextra -I../TestUtil -I../FrameCodec -I../SpscRing -I../Convert -DSTORE_FORWARD_TEST_MAIN store_forward.cpp store_forward_test.cpp -o store_forward_test && ./store_forward_test
+#include "store_forward_test.h"
+#include "store_forward.h"
+#include "test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// log in memory, bounded like flash partition
+class MemoryLog : public StoreForwardLog
+{
+public:
+    explicit MemoryLog(uint32_t size) : m_size(size) {}
+
+    bool fits(uint32_t len) const override { return (m_bytes + len) <= m_size; }
+
+    bool append(const uint8_t* data, uint32_t len) override
+    {
+        if (!fits(len)) {
+            return false;
+        }
+        m_entries.push_back(std::vector<uint8_t>(data, data + len));
+        m_bytes += len;
+        return true;
+    }
+
+    int read(uint8_t* out, uint32_t size) override
+    {
+        if (m_read >= m_entries.size() || m_entries[m_read].size() > size) {
+            return -1;
+        }
+        const std::vector<uint8_t>& entry = m_entries[m_read++];
+        memcpy(out, entry.data(), entry.size());
+        if (m_read == m_entries.size()) {
+            clear(); // append-only: space comes back when all is read
+        }
+        return static_cast<int>(entry.size());
+    }
+
+    uint32_t used() const override
+    {
+        uint32_t used = 0;
+        for (size_t i = m_read; i < m_entries.size(); ++i) {
+            used += static_cast<uint32_t>(m_entries[i].size());
+        }
+        return used;
+    }
+
+    void clear() override
+    {
+        m_entries.clear();
+        m_read = 0;
+        m_bytes = 0;
+    }
+
+private:
+    uint32_t m_size;
+    uint32_t m_bytes = 0;
+    size_t m_read = 0;
+    std::vector<std::vector<uint8_t> > m_entries;
+};
+
+// store with recorded link side, frame id is in first two bytes
+struct Line
+{
+    StoreForward store{fakeClock};
+    std::vector<int> sent;
+    std::vector<uint32_t> sentTime;     // frameTime() seen by output()
+    int sentStored = 0;
+    bool transportReady = true;
+
+    explicit Line(StorePolicy policy)
+    {
+        fakeTime() = 0;
+        store.setPolicy(policy);
+        store.output([this](int len, uint8_t* data) {
+            if (len >= 2) {
+                sent.push_back((data[0] << 8) | data[1]);
+                sentTime.push_back(store.frameTime());
+                sentStored += store.frameStored() ? 1 : 0;
+            }
+        });
+        store.ready([this](int) {
+            return transportReady;
+        });
+    }
+
+    bool write(int id, int len = 100)
+    {
+        uint8_t frame[FRAME_CODEC_MAX_PAYLOAD];
+        memset(frame, 0, len);
+        frame[0] = static_cast<uint8_t>(id >> 8);
+        frame[1] = static_cast<uint8_t>(id);
+        return store.write(len, frame);
+    }
+
+    bool inOrder(int from, int to) const
+    {
+        if (sent.size() != static_cast<size_t>(to - from)) {
+            return false;
+        }
+        for (int i = from; i < to; ++i) {
+            if (sent[i - from] != i) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// entries of 100 byte frames that fit RAM
+static const int ramFrames = STORE_FORWARD_RAM_SIZE / (SpscFrameRing<STORE_FORWARD_RAM_SIZE>::header + STORE_FORWARD_TIME_SIZE + 100);
+
+static void testPassThrough(void)
+{
+    Line line(STORE_DROP_OLDEST);
+    line.store.setLink(true);
+    for (int i = 0; i < 10; ++i) {
+        line.write(i);
+    }
+    TEST_ASSERT("link up: frames pass at once", line.inOrder(0, 10) && line.store.stats().passed == 10);
+    TEST_ASSERT("link up: nothing stored", line.store.empty() && line.store.stats().stored == 0);
+    TEST_ASSERT("link up: frames not marked stored", line.sentStored == 0);
+}
+
+static void testReplayInOrder(void)
+{
+    Line line(STORE_DROP_OLDEST);
+    for (int i = 0; i < 20; ++i) {
+        fakeTime() = static_cast<uint32_t>(i * 10);
+        line.write(i);
+    }
+    line.store.proceed();
+    TEST_ASSERT("link down: frames are stored", line.sent.empty() && line.store.stats().stored == 20);
+
+    line.store.setLink(true);
+    line.write(20); // new frame must wait for stored ones
+    line.store.proceed();
+    TEST_ASSERT("replay: all frames in write order", line.inOrder(0, 21));
+    TEST_ASSERT("replay: store is empty", line.store.empty());
+    TEST_ASSERT("replay: write time kept", line.sentTime.size() == 21 && line.sentTime[0] == 0 && line.sentTime[19] == 190);
+    TEST_ASSERT("replay: stored frames marked, new one passed", line.sentStored == 20);
+}
+
+static void testDropNewest(void)
+{
+    Line line(STORE_DROP_NEWEST);
+    int accepted = 0;
+    for (int i = 0; i < ramFrames + 10; ++i) {
+        accepted += line.write(i);
+    }
+    TEST_ASSERT("drop newest: RAM full", accepted == ramFrames && line.store.stats().droppedNewest == 10);
+
+    line.store.setLink(true);
+    line.store.proceed();
+    TEST_ASSERT("drop newest: oldest frames kept", line.inOrder(0, ramFrames));
+}
+
+static void testDropOldest(void)
+{
+    Line line(STORE_DROP_OLDEST);
+    const int total = ramFrames + 10;
+    for (int i = 0; i < total; ++i) {
+        line.write(i);
+    }
+    TEST_ASSERT("drop oldest: counted", line.store.stats().droppedOldest == 10);
+
+    line.store.setLink(true);
+    line.store.proceed();
+    TEST_ASSERT("drop oldest: newest frames kept", line.inOrder(10, total));
+}
+
+static void testSpillToLog(void)
+{
+    Line line(STORE_DROP_OLDEST);
+    MemoryLog log(64 * 1024);
+    line.store.setLog(&log);
+
+    const int total = ramFrames * 3;
+    for (int i = 0; i < total; ++i) {
+        line.write(i);
+    }
+    TEST_ASSERT("spill: nothing dropped", line.store.stats().droppedOldest == 0 && line.store.stats().droppedNewest == 0);
+    TEST_ASSERT("spill: entries went to log", line.store.stats().spilled > 0 && log.used() > 0);
+
+    // replay in parts while new frames keep coming
+    line.store.setLink(true);
+    line.transportReady = false;
+    for (int i = total; i < total + 5; ++i) {
+        line.write(i);
+    }
+    line.transportReady = true;
+    line.store.proceed();
+    TEST_ASSERT("spill: log, RAM and late frames in order", line.inOrder(0, total + 5));
+    TEST_ASSERT("spill: log is cleared", log.used() == 0 && line.store.empty());
+}
+
+static void testLogFull(void)
+{
+    Line line(STORE_DROP_NEWEST);
+    MemoryLog log(10 * (STORE_FORWARD_ENTRY_MAX));
+    line.store.setLog(&log);
+
+    int accepted = 0;
+    for (int i = 0; i < ramFrames * 3; ++i) {
+        accepted += line.write(i);
+    }
+    TEST_ASSERT("log full: new frames dropped", line.store.stats().droppedNewest > 0);
+
+    line.store.setLink(true);
+    line.store.proceed();
+    TEST_ASSERT("log full: accepted frames in order", line.inOrder(0, accepted));
+}
+
+static void testRetention(void)
+{
+    Line line(STORE_DROP_OLDEST);
+    line.store.setRetention(1000);
+    for (int i = 0; i < 5; ++i) {
+        line.write(i);
+    }
+    fakeTime() = 1500;
+    for (int i = 5; i < 10; ++i) {
+        line.write(i);
+    }
+    fakeTime() = 2100;
+
+    line.store.setLink(true);
+    line.store.proceed();
+    TEST_ASSERT("retention: old frames skipped", line.inOrder(5, 10) && line.store.stats().expired == 5);
+}
+
+static void testReplayRate(void)
+{
+    Line line(STORE_DROP_OLDEST);
+    for (int i = 0; i < 100; ++i) {
+        line.write(i);
+    }
+
+    line.store.setReplayRate(10000); // 100 frames per second
+    line.store.setLink(true);
+    line.store.proceed();
+    TEST_ASSERT("rate: nothing before time passes", line.sent.empty());
+
+    for (int i = 0; i < 100; ++i) {
+        fakeTime() += 5;
+        line.store.proceed();
+    }
+    TEST_ASSERT("rate: half of frames after half second", line.sent.size() >= 48 && line.sent.size() <= 51);
+
+    for (int i = 0; i < 120; ++i) {
+        fakeTime() += 5;
+        line.store.proceed();
+    }
+    TEST_ASSERT("rate: all frames in order", line.inOrder(0, 100));
+}
+
+static void testBackpressure(void)
+{
+    Line line(STORE_DROP_OLDEST);
+    line.store.setLink(true);
+    line.transportReady = false;
+    for (int i = 0; i < 10; ++i) {
+        line.write(i);
+    }
+    TEST_ASSERT("not ready: frames wait", line.sent.empty() && line.store.stats().stored == 10);
+
+    line.transportReady = true;
+    line.write(10);
+    TEST_ASSERT("ready: frames go in order", line.inOrder(0, 11));
+}
+
+
+int storeForwardTest(void)
+{
+    failCount = 0;
+    testPassThrough();
+    testReplayInOrder();
+    testDropNewest();
+    testDropOldest();
+    testSpillToLog();
+    testLogFull();
+    testRetention();
+    testReplayRate();
+    testBackpressure();
+
+    if (failCount == 0) {
+        printf("store and forward: all tests passed\n");
+    }
+    return failCount;
+}
+
+
+#ifdef STORE_FORWARD_TEST_MAIN
+int main(void)
+{
+    return storeForwardTest() ? 1 : 0;
+}
+#endif /* STORE_FORWARD_TEST_MAIN */
@@ -0,0 +1,7 @@
+#ifndef STORE_FORWARD_TEST_H
+#define STORE_FORWARD_TEST_H
+
+// returns count of failed checks
+int storeForwardTest(void);
+
+#endif /* STORE_FORWARD_TEST_H */
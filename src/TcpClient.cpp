@@ -1,30 +1,48 @@
 #include "TcpClient.hpp"
+#include <WiFi.h>
+#include <limits.h>
+#include <string.h>
+#include <lwip/sockets.h>
 
 
 TcpClient::TcpClient()
 {
-    //m_buffer = new uint8_t[150];
+    m_decoder.on([this](int len, uint8_t* data) {
+        _proceedPack(len, data);
+    });
 }
 
 void TcpClient::proceed()
 {
-    int len  = m_client.read(m_tmp, 10);
-    
-    //return;
-    for (int  i = 0; i < len; ++i) {
-        auto ch = m_tmp[i];
-
-        if (m_triggerSB) {
-            if(ch == m_startByte) { //{SB}{SB} -> {SB}
-                _proceedByte(ch, false);
-            } else { //{SB}{!SB} -> {SB} and newframe
-                _proceedByte(ch, true);
+    // one non-blocking recv() per chunk: data, "no data" or closed/broken socket,
+    // idle call costs one syscall (no available() / connected() peeks)
+    const int fd = m_client.fd();
+    if (fd < 0) {
+        return;
+    }
+
+    int budget = m_rxBudget > 0 ? m_rxBudget : INT_MAX;
+
+    while (budget > 0) {
+        const int n = budget < TCP_CLIENT_RX_CHUNK ? budget : TCP_CLIENT_RX_CHUNK;
+        int len = ::recv(fd, m_rxChunk, n, MSG_DONTWAIT);
+        if (len <= 0) {
+            if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                m_lost = true;
             }
-            m_triggerSB = false;
-        } else if (ch == m_startByte) { //{!SB}{SB} -> set flag and skip step
-            m_triggerSB = true;
-        } else { //{!SB}{!SB} -> {!SB}
-            _proceedByte(ch, false);
+            break;
+        }
+        m_stats.bytesIn += len;
+
+        if (!m_raw) {
+            m_decoder.proceed(m_rxChunk, len);
+        } else if (m_rawHandler) {
+            m_rawHandler(len, m_rxChunk);
+        }
+        budget -= len;
+
+        if (len < n) {
+            break; // socket is drained
         }
     }
 }
@@ -36,31 +54,61 @@ int TcpClient::clientAutoProceedNonBlock(unsigned int timeMs, const uint16_t por
     switch (clientAutoState)
     {
         case 0:
-            if (connected()) {
-                proceed();
+            // state changes come from socket errors (m_lost) and disconnect()
+            proceed();
+            _serviceTx();
+            if (!m_lost) {
                 return CLIENT_OK;
             }
-            ++clientAutoState;
+            ++m_stats.disconnects;
+            m_client.stop();
+            m_lost = false;
+            clientAutoState = 1;
             return CLIENT_TRY_CONNECT;
             break;
 
-        case 1:
-            if (connect(host, port)) {
-                clientAutoState = 0;
+        case 1: // start connect
+            clientAutolastTime = timeMs;
+            switch (_connectStart(host, port)) {
+            case 1:
+                _connected(timeMs);
                 return CLIENT_CONNECTED;
+            case 0:
+                clientAutoState = 3;
+                return CLIENT_TRY_CONNECT;
+            default:
+                ++m_stats.connectFails;
+                _backoff(timeMs);
+                break;
             }
-            ++clientAutoState;
-            clientAutolastTime = timeMs;
             break;
 
-        case 2:
-            if((timeMs - clientAutolastTime) > CLIENT_TIMEOUT) {
+        case 2: // backoff
+            if((timeMs - clientAutolastTime) >= m_backoffMs) {
                 clientAutoState = 1;
-                clientAutolastTime = timeMs;
                 return CLIENT_TRY_CONNECT;
             }
             break;
 
+        case 3: // connect in progress
+            switch (_connectPoll()) {
+            case 1:
+                _connected(timeMs);
+                return CLIENT_CONNECTED;
+            case 0:
+                if ((timeMs - clientAutolastTime) < CLIENT_CONNECT_TIMEOUT_MS) {
+                    return CLIENT_TRY_CONNECT;
+                }
+                ++m_stats.connectTimeouts;
+                break;
+            default:
+                ++m_stats.connectFails;
+                break;
+            }
+            _connectAbort();
+            _backoff(timeMs);
+            break;
+
         default:
             clientAutoState = 1;
             break;
@@ -69,82 +117,419 @@ int TcpClient::clientAutoProceedNonBlock(unsigned int timeMs, const uint16_t por
     return CLIENT_ERROR_CONNECTION;
 }
 
+void TcpClient::disconnect()
+{
+    _connectAbort();
+    if (clientAutoState == 0) {
+        ++m_stats.disconnects;
+    }
+    m_client.stop();
+    m_lost = false;
+    clientAutoState = 1;
+}
+
+// returns 1 - connected, 0 - in progress, -1 - failed
+int TcpClient::_connectStart(const char* host, uint16_t port)
+{
+    if (!_resolve(host)) {
+        return -1;
+    }
+
+    const int fd = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = m_resolvedIp;
+
+    m_connectFd = fd;
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0) {
+        return 1;
+    }
+    if (errno == EINPROGRESS) {
+        return 0;
+    }
+
+    _connectAbort();
+    return -1;
+}
+
+// returns 1 - connected, 0 - in progress, -1 - failed
+int TcpClient::_connectPoll()
+{
+    fd_set writeSet;
+    FD_ZERO(&writeSet);
+    FD_SET(m_connectFd, &writeSet);
+    struct timeval timeout = {0, 0};
+
+    const int ready = ::select(m_connectFd + 1, nullptr, &writeSet, nullptr, &timeout);
+    if (ready == 0) {
+        return 0;
+    }
+    if (ready < 0) {
+        return -1;
+    }
+
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (::getsockopt(m_connectFd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+        return -1;
+    }
+    return 1;
+}
+
+void TcpClient::_connectAbort()
+{
+    if (m_connectFd >= 0) {
+        ::close(m_connectFd);
+        m_connectFd = -1;
+    }
+}
+
+void TcpClient::_connected(unsigned int timeMs)
+{
+    // same socket mode as WiFiClient::connect() leaves, TX path uses MSG_DONTWAIT anyway
+    fcntl(m_connectFd, F_SETFL, fcntl(m_connectFd, F_GETFL, 0) & ~O_NONBLOCK);
+    m_client = WiFiClient(m_connectFd);
+    m_connectFd = -1;
+    m_lost = false;
+
+    _txReconnect();
+    ++m_stats.connects;
+    m_stats.connectMs = timeMs - clientAutolastTime;
+    if (!m_stats.firstConnectMs) {
+        m_stats.firstConnectMs = millis();
+    }
+    m_connectFails = 0;
+    m_backoffMs = 0;
+    m_stats.backoffMs = 0;
+    clientAutoState = 0;
+}
+
+void TcpClient::_backoff(unsigned int timeMs)
+{
+    uint32_t delayMs = CLIENT_BACKOFF_MAX_MS;
+    if (m_connectFails < 16 && (CLIENT_BACKOFF_MIN_MS << m_connectFails) < CLIENT_BACKOFF_MAX_MS) {
+        delayMs = CLIENT_BACKOFF_MIN_MS << m_connectFails;
+    }
+    if (m_connectFails < UINT8_MAX) {
+        ++m_connectFails;
+    }
+
+    // jitter: boards which lost same AP do not retry in step
+    m_backoffMs = delayMs / 2 + static_cast<uint32_t>(random(delayMs / 2 + 1));
+    m_stats.backoffMs = m_backoffMs;
+    clientAutolastTime = timeMs;
+    clientAutoState = 2;
+}
+
+bool TcpClient::_resolve(const char* host)
+{
+    if (host == m_resolvedHost && m_resolvedIp) {
+        return true;
+    }
+
+    // literal address never blocks, name goes to DNS (blocking, once per host)
+    IPAddress ip;
+    if (!ip.fromString(host) && !WiFi.hostByName(host, ip)) {
+        return false;
+    }
+
+    m_resolvedHost = host;
+    m_resolvedIp = static_cast<uint32_t>(ip);
+    return m_resolvedIp != 0;
+}
+
 #endif /* CLIENT_AUTO */
 
 
 
 
-void TcpClient::_proceedByte(uint8_t ch, bool newFrame)
+void TcpClient::_proceedPack(int len, uint8_t* data) 
+{
+    //Serial.println("PACK received: ");
+
+    m_frameTimeUs = micros();
+    m_commands.dispatch(len, data);
+}
+
+void TcpClient::on(uint8_t cmd, CommandHandler::Foo foo)
+{
+    m_commands.on(cmd, CommandHandler(foo));
+}
+
+void TcpClient::on(uint8_t cmd, CommandHandler::CtxFoo foo, void* ctx)
+{
+    m_commands.on(cmd, CommandHandler(foo, ctx));
+}
+
+void TcpClient::on(uint8_t cmd, CommandHandler handler)
+{
+    m_commands.on(cmd, handler);
+}
+
+void TcpClient::write(int len, unsigned char *ptr)
 {
-    //Serial.print("PROCEED BYTE: "); Serial.print(ch); Serial.print("  ");Serial.print(newFrame); Serial.println("");
-    if (newFrame) {
-        m_frameCrc = 0xFF;
-        m_receivePos = 0;
+    // frame goes to queue whole or not at all, stream never breaks mid-frame
+    int size = FRAME_CODEC_ENCODED_SIZE(len);
+    const uint32_t free = m_txQueue.capacity() - m_txQueue.used();
+    if (static_cast<uint32_t>(size) > free) {
+        size = FrameEncoder::encodedSize(len, ptr);
+        if (size < 0) {
+            return;
+        }
+        if (static_cast<uint32_t>(size) > free) {
+            ++m_txStats.dropped;
+            m_txStats.droppedBytes += size;
+            return;
+        }
+    }
+
+    size = FrameEncoder::encode(len, ptr, m_txChunk, TCP_CLIENT_TX_CHUNK, [this](const uint8_t* data, int n) {
+        m_txQueue.write(data, n);
+    });
+    if (size > 0) {
+        ++m_stats.framesOut;
+        m_stats.bytesOut += len;
+        _queued(size);
     }
+}
 
-    if (m_receivePos == 0) {
-        m_receivePackLen = ch;
+void TcpClient::setRaw(bool raw)
+{
+    flush();
+    m_raw = raw;
+    m_decoder.reset();
+}
 
-        if (m_receivePackLen > m_startByte) {
-            m_receivePackLen -= 1;
+void TcpClient::onRaw(std::function<void(int len, uint8_t*)> foo)
+{
+    m_rawHandler = foo;
+}
+
+void TcpClient::writeRaw(int len, const unsigned char *ptr)
+{
+    if (len <= 0) {
+        return;
+    }
+
+    // zero-copy: nothing to keep order with and nothing to coalesce -> straight to socket
+    if (m_batchThreshold <= 0 && m_txQueue.empty() && m_client.fd() >= 0) {
+        int sent = ::send(m_client.fd(), ptr, len, MSG_DONTWAIT);
+        if (sent > 0) {
+            m_stats.bytesOut += sent;
+            m_txStats.sentBytes += sent;
+            ptr += sent;
+            len -= sent;
+            if (len == 0) {
+                return;
+            }
+            ++m_txStats.partialWrites;
+        } else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            ++m_txStats.sendErrors;
+            m_lost = true;
         }
-    } else if ((m_receivePos - 1) < m_receivePackLen) {
-        m_recBuffer[m_receivePos-1] = ch;
-    } else if ((m_receivePos - 1) == m_receivePackLen && m_frameCrc == ch) {
-            _proceedPack();
+    }
+
+    if (static_cast<uint32_t>(len) > (m_txQueue.capacity() - m_txQueue.used())) {
+        ++m_txStats.dropped;
+        m_txStats.droppedBytes += len;
+        return;
+    }
+
+    m_txQueue.write(ptr, len);
+    m_stats.bytesOut += len;
+    _queued(len);
+}
+
+void TcpClient::setTxBatching(int threshold, unsigned int deadlineUs)
+{
+    flush();
+    m_batchThreshold = threshold > TCP_CLIENT_BATCH_SIZE ? TCP_CLIENT_BATCH_SIZE : threshold;
+    m_batchDeadlineUs = deadlineUs;
+}
+
+void TcpClient::flush()
+{
+    _flush(FLUSH_CALL);
+    _sendQueued();
+}
+
+TcpTxQueueStats TcpClient::txStats() const
+{
+    TcpTxQueueStats stats = m_txStats;
+    stats.depth = static_cast<uint8_t>(m_markHead - m_markTail);
+    stats.pending = m_txQueue.used();
+    stats.highWater = m_txQueue.highWater();
+    stats.size = m_txQueue.capacity();
+    stats.avgTimeUs = m_txStats.samples ? static_cast<uint32_t>(m_timeSumUs / m_txStats.samples) : 0;
+    return stats;
+}
+
+void TcpClient::resetStats()
+{
+    const uint32_t firstConnectMs = m_stats.firstConnectMs;
+    const uint32_t firstFrameMs = m_stats.firstFrameMs;
+    m_stats = TcpClientStats();
+    m_stats.firstConnectMs = firstConnectMs;
+    m_stats.firstFrameMs = firstFrameMs;
+    m_txStats = TcpTxQueueStats();
+    m_timeSumUs = 0;
+    m_decoder.resetStats();
+}
+
+// new frame (or raw chunk) of len bytes is in queue
+void TcpClient::_queued(int len)
+{
+    const unsigned long now = micros();
+    m_txEnqueued += len;
+
+    // time in queue is tracked per frame, if marks are full last one is extended
+    if (static_cast<uint8_t>(m_markHead - m_markTail) < TCP_CLIENT_TX_MARKS) {
+        TxMark& mark = m_marks[m_markHead % TCP_CLIENT_TX_MARKS];
+        mark.end = m_txEnqueued;
+        mark.timeUs = now;
+        ++m_markHead;
     } else {
+        m_marks[(m_markHead - 1) % TCP_CLIENT_TX_MARKS].end = m_txEnqueued;
+    }
+
+    if (m_batchThreshold <= 0) {
+        m_txReleased += len;
+        _sendQueued();
         return;
     }
 
-    m_receivePos++;
-    m_frameCrc =  _proceedCrc(m_frameCrc, ch);
+    if (m_batchLen == 0) {
+        m_batchStartUs = now;
+    }
+    m_batchLen += len;
+    ++m_batchFrames;
+
+    if (m_batchLen >= m_batchThreshold) {
+        _flush(FLUSH_SIZE);
+    }
 }
 
-void TcpClient::_proceedPack() 
+void TcpClient::_flush(FlushReason reason)
 {
-    //Serial.println("PACK received: ");
-    
-    if (m_receivePackLen > 0) {
-        auto s = m_handlers.find(m_recBuffer[0]);
-        if (s != m_handlers.end()) {
-            s->second(m_receivePackLen - 1, (m_recBuffer+1));
-        }
+    if (m_batchLen == 0) {
+        return;
+    }
+
+    const uint32_t holdUs = static_cast<uint32_t>(micros() - m_batchStartUs);
+    TcpBatchStats& stats = m_batchStats;
+    ++stats.flushes;
+    switch (reason) {
+    case FLUSH_SIZE:     ++stats.bySize; break;
+    case FLUSH_DEADLINE: ++stats.byDeadline; break;
+    default:             ++stats.byCall; break;
     }
+    stats.frames += m_batchFrames;
+    stats.bytes += m_batchLen;
+    if (static_cast<uint32_t>(m_batchLen) > stats.maxBytes) {
+        stats.maxBytes = m_batchLen;
+    }
+    if (static_cast<uint32_t>(m_batchFrames) > stats.maxFrames) {
+        stats.maxFrames = m_batchFrames;
+    }
+    if (holdUs > stats.maxHoldUs) {
+        stats.maxHoldUs = holdUs;
+    }
+
+    m_txReleased += m_batchLen;
+    m_batchLen = 0;
+    m_batchFrames = 0;
+    _sendQueued();
 }
 
-void TcpClient::on(uint8_t cmd, std::function<void(int len, uint8_t*)> foo)
+// write released bytes without blocking, rest waits for next service tick
+void TcpClient::_sendQueued()
 {
-    m_handlers.insert({cmd, foo});
+    const int fd = m_client.fd();
+    if (fd < 0) {
+        return;
+    }
+
+    while (m_txReleased) {
+        const uint8_t* ptr;
+        uint32_t n = m_txQueue.readSpan(&ptr);
+        if (n > m_txReleased) {
+            n = m_txReleased;
+        }
+
+        int sent = ::send(fd, ptr, n, MSG_DONTWAIT);
+        if (sent <= 0) {
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                ++m_txStats.sendErrors;
+                m_lost = true;
+            }
+            break;
+        }
+
+        m_txQueue.consume(sent);
+        m_txReleased -= sent;
+        m_txSent += sent;
+        m_txStats.sentBytes += sent;
+        _sentMarks();
+
+        if (static_cast<uint32_t>(sent) < n) {
+            ++m_txStats.partialWrites; // socket buffer is full
+            break;
+        }
+    }
 }
 
-void TcpClient::write(int len, unsigned char *ptr)
+void TcpClient::_sentMarks()
 {
-    char crc = static_cast<char>(0xFF);
-    m_sendBuffer[0] = m_startByte;
-    m_sendBuffer[1] = len >= m_startByte ? len + 1 : len;
+    const unsigned long now = micros();
+    while (m_markHead != m_markTail) {
+        const TxMark& mark = m_marks[m_markTail % TCP_CLIENT_TX_MARKS];
+        if (static_cast<int32_t>(m_txSent - mark.end) < 0) {
+            break;
+        }
 
-    int pos = 2;
-    auto addByte = [&](uint8_t b) {
-        crc = _proceedCrc(crc, b);
-        m_sendBuffer[pos++] = b;
-        if (b == m_startByte) {
-            m_sendBuffer[pos++] = b;
+        const uint32_t timeUs = static_cast<uint32_t>(now - mark.timeUs);
+        if (timeUs > m_txStats.maxTimeUs) {
+            m_txStats.maxTimeUs = timeUs;
+        }
+        m_timeSumUs += timeUs;
+        ++m_txStats.samples;
+        m_txBoundary = mark.end;
+        if (!m_stats.firstFrameMs) {
+            m_stats.firstFrameMs = millis();
         }
-    };
+        ++m_markTail;
+    }
+}
 
-    for (uint8_t i = 0; i < len; i++) {
-        addByte(ptr[i]);
+// new connection: rest of frame cut by old connection would be garbage, skip it
+void TcpClient::_txReconnect()
+{
+    if (m_txSent == m_txBoundary || m_markHead == m_markTail) {
+        return;
     }
-    addByte(crc);
 
-    m_client.write(m_sendBuffer, pos);
+    const uint32_t skip = m_marks[m_markTail % TCP_CLIENT_TX_MARKS].end - m_txSent;
+    m_txQueue.consume(skip);
+    m_txReleased -= skip;
+    m_txSent += skip;
+    ++m_txStats.dropped;
+    m_txStats.droppedBytes += skip;
+    _sentMarks();
 }
 
-uint8_t TcpClient::_proceedCrc(uint8_t crc, uint8_t ch) {
-    crc ^= ch;
-    for (int i = 0; i < 8; i++)
-        crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
-    return crc;
+void TcpClient::_serviceTx()
+{
+    if (m_batchLen && (micros() - m_batchStartUs) >= m_batchDeadlineUs) {
+        _flush(FLUSH_DEADLINE);
+    }
+    _sendQueued();
 }
 
 
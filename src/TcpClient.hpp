@@ -2,7 +2,9 @@
 #define TCP_CLIENT
 //#include <functional.h>
 #include <WiFiClient.h>
-#include <map>
+#include "frame_codec.h"
+#include "command_table.h"
+#include "spsc_ring.h"
 
 #ifndef CLIENT_AUTO
 #   define CLIENT_AUTO
@@ -15,22 +17,122 @@
 #   define CLIENT_OK 2
 #   define CLIENT_ERROR_CONNECTION -1
 
-#   define CLIENT_TIMEOUT 500U
+// connect() runs without blocking, failed attempts are retried after jittered
+// exponential backoff: random in [d / 2, d], d = CLIENT_BACKOFF_MIN_MS * 2^fails up to CLIENT_BACKOFF_MAX_MS
+#   define CLIENT_BACKOFF_MIN_MS 100U
+#   define CLIENT_BACKOFF_MAX_MS 5000U
+#   define CLIENT_CONNECT_TIMEOUT_MS 3000U
 #endif /*CLIENT_AUTO*/
 
-#define TCP_CLIENT_BUFF_SIZE 256
+// TX path: encoder scratch, any frame size goes through it
+#define TCP_CLIENT_TX_CHUNK 512
+
+// TX queue: every encoded frame waits here whole (or is dropped whole if it does not fit),
+// socket is written without blocking, partial write is resumed on next service tick
+// (clientAutoProceedNonBlock() or next write())
+#ifndef TCP_CLIENT_TX_QUEUE
+#   define TCP_CLIENT_TX_QUEUE 8192U        // power of two
+#endif /* TCP_CLIENT_TX_QUEUE */
+#define TCP_CLIENT_TX_MARKS 32              // frames tracked for time in queue
+
+struct TcpTxQueueStats
+{
+    uint32_t depth = 0;         // frames waiting (up to TCP_CLIENT_TX_MARKS)
+    uint32_t pending = 0;       // bytes waiting
+    uint32_t highWater = 0;     // max bytes waiting
+    uint32_t size = 0;
+    uint32_t sentBytes = 0;
+    uint32_t dropped = 0;       // frames/raw chunks dropped: queue full or cut by reconnect
+    uint32_t droppedBytes = 0;
+    uint32_t partialWrites = 0; // socket took only part of bytes
+    uint32_t sendErrors = 0;
+    uint32_t maxTimeUs = 0;     // time in queue, from write() to last byte taken by socket
+    uint32_t avgTimeUs = 0;
+    uint32_t samples = 0;
+};
+
+// TX batching: queued frames are held until threshold is reached (max about one TCP
+// segment), until oldest frame waited deadlineUs, or until flush()
+#define TCP_CLIENT_BATCH_SIZE 1460
+#ifndef TCP_CLIENT_BATCH_DEADLINE_US
+#   define TCP_CLIENT_BATCH_DEADLINE_US 2000U
+#endif /* TCP_CLIENT_BATCH_DEADLINE_US */
+
+struct TcpBatchStats
+{
+    uint32_t flushes = 0;
+    uint32_t bySize = 0;        // batch threshold reached
+    uint32_t byDeadline = 0;
+    uint32_t byCall = 0;        // flush() called
+    uint32_t frames = 0;
+    uint32_t bytes = 0;
+    uint32_t maxBytes = 0;      // biggest flush
+    uint32_t maxFrames = 0;     // most frames in one flush
+    uint32_t maxHoldUs = 0;     // longest time first frame waited in batch
+};
+
+struct TcpClientStats
+{
+    uint32_t bytesIn = 0;       // bytes read from socket (framed and raw)
+    uint32_t framesOut = 0;     // frames taken by TX queue
+    uint32_t bytesOut = 0;      // payload bytes of queued frames, raw bytes as they are
+    uint32_t connects = 0;
+    uint32_t disconnects = 0;   // established connection was lost
+    uint32_t connectFails = 0;  // refused, unreachable, no route, DNS
+    uint32_t connectTimeouts = 0;
+    uint32_t connectMs = 0;     // last successful attempt, from start to established
+    uint32_t backoffMs = 0;     // current retry delay
+    uint32_t firstConnectMs = 0; // millis() of first connection after boot, not cleared by resetStats()
+    uint32_t firstFrameMs = 0;  // millis() when first frame was taken by socket, not cleared by resetStats()
+};
+
+// RX path: bytes per read and default max bytes per proceed() call
+#define TCP_CLIENT_RX_CHUNK 512
+#ifndef TCP_CLIENT_RX_BUDGET
+#   define TCP_CLIENT_RX_BUDGET 4096
+#endif /* TCP_CLIENT_RX_BUDGET */
 
 class TcpClient 
 {
 public:
     TcpClient();
     inline bool connected() {return m_client.connected();}
+    // drop connection now (e.g. Wi-Fi lost event), clientAutoProceedNonBlock() connects again
+    void disconnect();
     inline bool connect(const char* host, uint16_t port) { return m_client.connect(host, port); }
     void write(int len, unsigned char*);
 
-    void on(uint8_t cmd, std::function<void(int len, uint8_t*)>);
+    void on(uint8_t cmd, CommandHandler::Foo foo);
+    void on(uint8_t cmd, CommandHandler::CtxFoo foo, void* ctx);
+    void on(uint8_t cmd, CommandHandler handler);
     void proceed();
 
+    // micros() when frame now given to command handler was decoded
+    inline unsigned long frameTimeUs() const {return m_frameTimeUs;}
+
+    // raw mode: no framing, socket bytes go to onRaw() handler from read buffer,
+    // writeRaw() bytes go to socket as they are (through TX queue if it is not empty or batching is on)
+    void setRaw(bool raw);
+    inline bool isRaw() const {return m_raw;}
+    void onRaw(std::function<void(int len, uint8_t*)>);
+    void writeRaw(int len, const unsigned char*);
+
+    // max bytes moved from socket per proceed() call, <= 0 -> drain all available
+    inline void setRxBudget(int bytes) {m_rxBudget = bytes;}
+
+    // threshold <= 0 -> every frame is written at once (no batching)
+    void setTxBatching(int threshold, unsigned int deadlineUs = TCP_CLIENT_BATCH_DEADLINE_US);
+    void flush();
+    inline const TcpBatchStats& batchStats() const {return m_batchStats;}
+    inline void resetBatchStats() {m_batchStats = TcpBatchStats();}
+    TcpTxQueueStats txStats() const;
+    // TX queue space, bytes (frame of len bytes always fits in FRAME_CODEC_ENCODED_SIZE(len))
+    inline uint32_t txFree() const {return m_txQueue.capacity() - m_txQueue.used();}
+
+    inline const TcpClientStats& stats() const {return m_stats;}
+    inline const FrameDecoderStats& decoderStats() const {return m_decoder.stats();}
+    void resetStats();
+
     #ifdef CLIENT_AUTO
         int clientAutoProceedNonBlock(unsigned int timeMs, const uint16_t port, const char * host);
     #endif /*CLIENT_AUTO*/
@@ -39,29 +141,68 @@ private:
 #ifdef CLIENT_AUTO
     int clientAutoState = 1;
     unsigned int clientAutolastTime;
-#endif /*CLIENT_AUTO*/
-
-    void _proceedByte(uint8_t byte, bool newFrame);
-    uint8_t _proceedCrc(uint8_t crc, uint8_t ch);
-    void _proceedPack();
-
-    WiFiClient m_client;
-    std::map<uint8_t, std::function<void(int len, uint8_t*)>> m_handlers;
-    int m_packLen = -1;
-    uint8_t *m_buffer;
 
+    int _connectStart(const char* host, uint16_t port);
+    int _connectPoll();
+    void _connectAbort();
+    void _connected(unsigned int timeMs);
+    void _backoff(unsigned int timeMs);
+    bool _resolve(const char* host);
+
+    int m_connectFd = -1;
+    uint8_t m_connectFails = 0;     // failed attempts in row
+    uint32_t m_backoffMs = 0;
+    const char* m_resolvedHost = nullptr;
+    uint32_t m_resolvedIp = 0;      // network byte order
+#endif /*CLIENT_AUTO*/
 
+    enum FlushReason { FLUSH_SIZE, FLUSH_DEADLINE, FLUSH_CALL };
 
-    const uint8_t m_startByte = 0x1A;
-    uint8_t m_recBuffer[TCP_CLIENT_BUFF_SIZE];
-    uint8_t m_sendBuffer[TCP_CLIENT_BUFF_SIZE];
+    void _proceedPack(int len, uint8_t* data);
+    struct TxMark {
+        uint32_t end;           // m_txEnqueued after frame
+        unsigned long timeUs;   // when frame was queued
+    };
 
-    uint8_t m_tmp[10];
+    void _queued(int len);
+    void _flush(FlushReason reason);
+    void _sendQueued();
+    void _sentMarks();
+    void _txReconnect();
+    void _serviceTx();
 
-    bool m_triggerSB = false;
-    uint8_t m_frameCrc = 0xFF;
-    uint8_t m_receivePos = 0;
-    uint16_t m_receivePackLen = 0;
+    WiFiClient m_client;
+    bool m_lost = false;        // recv()/send() saw closed or broken socket
+    FrameDecoder m_decoder;
+    CommandTable m_commands;
+
+    bool m_raw = false;
+    std::function<void(int len, uint8_t*)> m_rawHandler = nullptr;
+
+    uint8_t m_txChunk[TCP_CLIENT_TX_CHUNK];
+    SpscByteRing<TCP_CLIENT_TX_QUEUE> m_txQueue;
+    uint32_t m_txReleased = 0;  // queued bytes allowed to go (not held by batching)
+    uint32_t m_txEnqueued = 0;  // free running byte counters
+    uint32_t m_txSent = 0;
+    uint32_t m_txBoundary = 0;  // m_txSent at end of last fully sent frame
+    TxMark m_marks[TCP_CLIENT_TX_MARKS];
+    uint8_t m_markHead = 0;
+    uint8_t m_markTail = 0;
+    uint64_t m_timeSumUs = 0;
+    TcpTxQueueStats m_txStats;
+
+    int m_batchLen = 0;         // queued bytes held by batching
+    int m_batchFrames = 0;
+    unsigned long m_batchStartUs = 0;
+    int m_batchThreshold = 0;
+    unsigned int m_batchDeadlineUs = TCP_CLIENT_BATCH_DEADLINE_US;
+    TcpBatchStats m_batchStats;
+
+    TcpClientStats m_stats;
+    unsigned long m_frameTimeUs = 0;
+
+    uint8_t m_rxChunk[TCP_CLIENT_RX_CHUNK];
+    int m_rxBudget = TCP_CLIENT_RX_BUDGET;
 };
 
 
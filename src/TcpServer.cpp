@@ -0,0 +1,250 @@
+#include "TcpServer.hpp"
+#include <lwip/sockets.h>
+
+static_assert(TCP_SERVER_CLIENT_QUEUE <= 128 && (TCP_SERVER_CLIENT_QUEUE & (TCP_SERVER_CLIENT_QUEUE - 1)) == 0,
+              "TCP_SERVER_CLIENT_QUEUE must be power of two <= 128");
+static_assert(TCP_SERVER_POOL_FRAMES < 256, "slot index must fit uint8_t");
+static_assert(TCP_SERVER_SLOT_SIZE <= 0xFFFF, "slot len must fit uint16_t");
+
+#define TCP_SERVER_QUEUE_MASK (TCP_SERVER_CLIENT_QUEUE - 1)
+
+
+TcpServer::TcpServer(uint16_t port) :
+    m_server(port, TCP_SERVER_MAX_CLIENTS)
+{
+    for (int i = 0; i < TCP_SERVER_MAX_CLIENTS; ++i) {
+        m_clients[i].decoder.on([this](int len, uint8_t* data) {
+            m_commands.dispatch(len, data);
+        });
+    }
+}
+
+void TcpServer::begin()
+{
+    m_server.begin();
+    m_server.setNoDelay(true);
+}
+
+void TcpServer::on(uint8_t cmd, CommandHandler::Foo foo)
+{
+    m_commands.on(cmd, CommandHandler(foo));
+}
+
+void TcpServer::on(uint8_t cmd, CommandHandler::CtxFoo foo, void* ctx)
+{
+    m_commands.on(cmd, CommandHandler(foo, ctx));
+}
+
+void TcpServer::on(uint8_t cmd, CommandHandler handler)
+{
+    m_commands.on(cmd, handler);
+}
+
+void TcpServer::write(int len, unsigned char *ptr)
+{
+    if (clientCount() == 0) {
+        return;
+    }
+
+    // make room first: full queues drop own oldest frames, so free slot always exists
+    for (int i = 0; i < TCP_SERVER_MAX_CLIENTS; ++i) {
+        Client& client = m_clients[i];
+        if (client.active && static_cast<uint8_t>(client.head - client.tail) == TCP_SERVER_CLIENT_QUEUE) {
+            _drop(client);
+        }
+    }
+
+    int idx = _allocSlot();
+    if (idx < 0) {
+        return;
+    }
+
+    // encode once for all clients
+    Slot& slot = m_pool[idx];
+    int size = FrameEncoder::encode(len, ptr, slot.data);
+    if (size <= 0) {
+        return;
+    }
+    slot.len = static_cast<uint16_t>(size);
+
+    for (int i = 0; i < TCP_SERVER_MAX_CLIENTS; ++i) {
+        Client& client = m_clients[i];
+        if (!client.active) {
+            continue;
+        }
+
+        client.queue[client.head & TCP_SERVER_QUEUE_MASK] = static_cast<uint8_t>(idx);
+        ++client.head;
+        ++slot.refs;
+
+        const uint8_t used = client.head - client.tail;
+        if (used > client.stats.highWater) {
+            client.stats.highWater = used;
+        }
+    }
+}
+
+void TcpServer::proceed()
+{
+    _accept();
+
+    for (int i = 0; i < TCP_SERVER_MAX_CLIENTS; ++i) {
+        Client& client = m_clients[i];
+        if (!client.active) {
+            continue;
+        }
+
+        // lost connection shows up as recv() result, no connected() peek every call
+        if (!_receive(client)) {
+            _close(client);
+            continue;
+        }
+        while (client.head != client.tail && _send(client)) {
+        }
+    }
+}
+
+int TcpServer::clientCount() const
+{
+    int count = 0;
+    for (int i = 0; i < TCP_SERVER_MAX_CLIENTS; ++i) {
+        count += m_clients[i].active;
+    }
+    return count;
+}
+
+TcpServerClientStats TcpServer::clientStats(int idx) const
+{
+    if (idx < 0 || idx >= TCP_SERVER_MAX_CLIENTS) {
+        return TcpServerClientStats();
+    }
+    TcpServerClientStats stats = m_clients[idx].stats;
+    stats.connected = m_clients[idx].active;
+    return stats;
+}
+
+void TcpServer::_accept()
+{
+    while (m_server.hasClient()) {
+        WiFiClient socket = m_server.available();
+
+        Client* freeClient = nullptr;
+        for (int i = 0; i < TCP_SERVER_MAX_CLIENTS; ++i) {
+            if (!m_clients[i].active) {
+                freeClient = &m_clients[i];
+                break;
+            }
+        }
+
+        if (!freeClient) { // no room, refuse
+            socket.stop();
+            continue;
+        }
+
+        socket.setNoDelay(true);
+        freeClient->socket = socket;
+        freeClient->decoder.reset();
+        freeClient->head = freeClient->tail = 0;
+        freeClient->offset = 0;
+        freeClient->stats = TcpServerClientStats();
+        freeClient->active = true;
+    }
+}
+
+// returns false if connection is closed by peer or broken
+bool TcpServer::_receive(Client& client)
+{
+    const int fd = client.socket.fd();
+    while (true) {
+        int len = ::recv(fd, m_rxChunk, TCP_SERVER_RX_CHUNK, MSG_DONTWAIT);
+        if (len <= 0) {
+            return len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+        client.decoder.proceed(m_rxChunk, len);
+
+        if (len < TCP_SERVER_RX_CHUNK) {
+            return true; // socket is drained, no extra call
+        }
+    }
+}
+
+// returns true if head frame was sent completely
+bool TcpServer::_send(Client& client)
+{
+    const uint8_t idx = client.queue[client.tail & TCP_SERVER_QUEUE_MASK];
+    const Slot& slot = m_pool[idx];
+
+    // WiFiClient::write() waits while socket buffer is full, non blocking send keeps other clients going
+    int n = ::send(client.socket.fd(), slot.data + client.offset, slot.len - client.offset, MSG_DONTWAIT);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            _close(client);
+        }
+        return false;
+    }
+
+    client.offset += n;
+    client.stats.bytes += n;
+    if (client.offset < slot.len) {
+        return false;
+    }
+
+    client.offset = 0;
+    ++client.tail;
+    ++client.stats.frames;
+    _release(idx);
+    return true;
+}
+
+// drop oldest frame that is not in flight
+void TcpServer::_drop(Client& client)
+{
+    uint8_t pos = client.tail;
+    if (client.offset) {
+        ++pos; // head frame is partly sent, keep it
+    }
+
+    if (pos == client.head) {
+        return;
+    }
+
+    const uint8_t idx = client.queue[pos & TCP_SERVER_QUEUE_MASK];
+    // shift frames before dropped one up by one
+    while (pos != client.tail) {
+        client.queue[pos & TCP_SERVER_QUEUE_MASK] = client.queue[(pos - 1) & TCP_SERVER_QUEUE_MASK];
+        --pos;
+    }
+    ++client.tail;
+    ++client.stats.dropped;
+    _release(idx);
+}
+
+void TcpServer::_close(Client& client)
+{
+    while (client.head != client.tail) {
+        _release(client.queue[client.tail & TCP_SERVER_QUEUE_MASK]);
+        ++client.tail;
+    }
+    client.offset = 0;
+    client.socket.stop();
+    client.active = false;
+}
+
+void TcpServer::_release(uint8_t slot)
+{
+    if (m_pool[slot].refs) {
+        --m_pool[slot].refs;
+    }
+}
+
+int TcpServer::_allocSlot()
+{
+    for (int i = 0; i < TCP_SERVER_POOL_FRAMES; ++i) {
+        if (m_pool[i].refs == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#undef TCP_SERVER_QUEUE_MASK
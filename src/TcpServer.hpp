@@ -0,0 +1,95 @@
+#ifndef TCP_SERVER
+#define TCP_SERVER
+
+#include <WiFiServer.h>
+#include <WiFiClient.h>
+#include "frame_codec.h"
+#include "command_table.h"
+
+/*
+ * Server mode: several host tools connect to ESP32 at once.
+ *
+ * write() encodes frame once into shared reference counted slot, every client gets
+ * slot index in own send queue. Client sockets are written without blocking, client
+ * that can not keep up only loses own oldest frames (queue full) and never stalls
+ * others. Slot being sent right now is never dropped, so TCP stream stays valid.
+ *
+ * Frames from any client go through shared command table, same as TcpClient::on().
+ */
+
+#ifndef TCP_SERVER_MAX_CLIENTS
+#   define TCP_SERVER_MAX_CLIENTS 4
+#endif /* TCP_SERVER_MAX_CLIENTS */
+
+// frames waiting per client (power of two, <= 128)
+#ifndef TCP_SERVER_CLIENT_QUEUE
+#   define TCP_SERVER_CLIENT_QUEUE 8
+#endif /* TCP_SERVER_CLIENT_QUEUE */
+
+// live slots: last TCP_SERVER_CLIENT_QUEUE frames + one in flight per client + one to encode new frame
+#define TCP_SERVER_POOL_FRAMES (TCP_SERVER_CLIENT_QUEUE + TCP_SERVER_MAX_CLIENTS + 1)
+#define TCP_SERVER_SLOT_SIZE FRAME_CODEC_ENCODED_SIZE(FRAME_CODEC_MAX_PAYLOAD)
+
+#define TCP_SERVER_RX_CHUNK 512
+
+struct TcpServerClientStats
+{
+    bool connected = false;
+    uint32_t frames = 0;    // frames fully sent
+    uint32_t dropped = 0;   // frames lost because client queue was full
+    uint32_t bytes = 0;     // bytes sent
+    uint32_t highWater = 0; // max frames waiting in queue
+};
+
+class TcpServer
+{
+public:
+    TcpServer(uint16_t port);
+
+    void begin();
+    void write(int len, unsigned char*);
+
+    void on(uint8_t cmd, CommandHandler::Foo foo);
+    void on(uint8_t cmd, CommandHandler::CtxFoo foo, void* ctx);
+    void on(uint8_t cmd, CommandHandler handler);
+
+    // accept new clients, read and dispatch frames, send queued frames
+    void proceed();
+
+    int clientCount() const;
+    TcpServerClientStats clientStats(int idx) const;
+
+private:
+    struct Slot {
+        uint16_t len = 0;
+        uint8_t refs = 0;
+        uint8_t data[TCP_SERVER_SLOT_SIZE];
+    };
+
+    struct Client {
+        WiFiClient socket;
+        FrameDecoder decoder;
+        bool active = false;
+        uint8_t queue[TCP_SERVER_CLIENT_QUEUE];
+        uint8_t head = 0;   // free running, mod TCP_SERVER_CLIENT_QUEUE
+        uint8_t tail = 0;
+        uint16_t offset = 0; // bytes of queue[tail] already sent
+        TcpServerClientStats stats;
+    };
+
+    void _accept();
+    bool _receive(Client& client);
+    bool _send(Client& client);
+    void _drop(Client& client);
+    void _close(Client& client);
+    void _release(uint8_t slot);
+    int _allocSlot();
+
+    WiFiServer m_server;
+    CommandTable m_commands;
+    Client m_clients[TCP_SERVER_MAX_CLIENTS];
+    Slot m_pool[TCP_SERVER_POOL_FRAMES];
+    uint8_t m_rxChunk[TCP_SERVER_RX_CHUNK];
+};
+
+#endif /* TCP_SERVER */
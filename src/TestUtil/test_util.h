@@ -0,0 +1,33 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Common part of library tests (*_test.cpp), header only, every test file gets own copy:
+ *  failCount     - failed checks, xTest() clears it first and returns it
+ *  TEST_ASSERT() - counts and prints failed check
+ *  fakeClock     - millisecond Clock for classes under test, moved by hand with fakeTime()
+ */
+
+static int failCount = 0;
+
+static inline void TEST_ASSERT(const char* description, bool check)
+{
+    if(!check) {
+        fprintf(stderr, "TEST FAILED: %s\n", description);
+        fflush(stderr);
+        ++failCount;
+    }
+}
+
+static inline uint32_t& fakeTime(void)
+{
+    static uint32_t now = 0;
+    return now;
+}
+
+static inline uint32_t fakeClock(void) { return fakeTime(); }
+
+#endif /* TEST_UTIL_H */
@@ -0,0 +1,66 @@
+#include "udp_datagram.h"
+
+
+DatagramReader::DatagramReader()
+{
+
+}
+
+void DatagramReader::setSequence(bool enable)
+{
+    m_sequence = enable;
+    m_seqValid = false;
+    m_decoder.reset();
+}
+
+void DatagramReader::on(std::function<void(int len, uint8_t*)> foo)
+{
+    m_decoder.on(foo);
+}
+
+void DatagramReader::writeHeader(uint8_t* out, uint32_t seq)
+{
+    out[0] = UDP_DATAGRAM_SEQ_MARK;
+    out[1] = static_cast<uint8_t>(seq >> 24);
+    out[2] = static_cast<uint8_t>(seq >> 16);
+    out[3] = static_cast<uint8_t>(seq >> 8);
+    out[4] = static_cast<uint8_t>(seq);
+}
+
+void DatagramReader::proceed(const uint8_t* data, int len)
+{
+    if (len <= 0) {
+        return;
+    }
+
+    ++m_stats.datagrams;
+    m_stats.bytes += len;
+
+    if (m_sequence) {
+        if (len < UDP_DATAGRAM_SEQ_SIZE || data[0] != UDP_DATAGRAM_SEQ_MARK) {
+            ++m_stats.badHeader;
+            m_decoder.reset(); // part of stream is missing now
+            return;
+        }
+
+        const uint32_t seq = (static_cast<uint32_t>(data[1]) << 24) | (static_cast<uint32_t>(data[2]) << 16) |
+                             (static_cast<uint32_t>(data[3]) << 8) | data[4];
+        const int32_t diff = static_cast<int32_t>(seq - m_seqExpected);
+
+        if (m_seqValid && diff < 0) {
+            ++m_stats.reordered;
+        } else {
+            if (m_seqValid && diff > 0) {
+                m_stats.lost += static_cast<uint32_t>(diff);
+                m_decoder.reset(); // frame split over lost datagram can not complete
+            }
+            m_seqExpected = seq + 1;
+            m_seqValid = true;
+        }
+
+        data += UDP_DATAGRAM_SEQ_SIZE;
+        len -= UDP_DATAGRAM_SEQ_SIZE;
+    }
+
+    m_decoder.proceed(data, len);
+}
@@ -0,0 +1,58 @@
+#ifndef UDP_DATAGRAM_H
+#define UDP_DATAGRAM_H
+
+#include <stdint.h>
+#include <functional>
+#include "frame_codec.h"
+
+/*
+ * Datagram framing of UDP transport (platform independent):
+ *
+ *      [{UDP_DATAGRAM_SEQ_MARK}{seq >> 24}{seq >> 16}{seq >> 8}{seq}] {frame} ... {frame}
+ *
+ * Sequence header is configured, not detected: continuation datagram of split frame
+ * starts with any encoded byte, so both ends must use same setSequence() setting.
+ * With sequence on, datagram without mark is dropped (badHeader).
+ */
+
+#define UDP_DATAGRAM_SEQ_MARK ((uint8_t)'S')
+#define UDP_DATAGRAM_SEQ_SIZE 5
+
+struct DatagramReaderStats
+{
+    uint32_t datagrams = 0;
+    uint32_t bytes = 0;
+    uint32_t lost = 0;          // sequence gaps (datagrams never received)
+    uint32_t reordered = 0;     // datagrams older than expected (late or duplicated)
+    uint32_t badHeader = 0;     // sequence on, but header missing or short
+};
+
+class DatagramReader
+{
+public:
+    DatagramReader();
+
+    // must match sender, state is reset
+    void setSequence(bool enable);
+    inline bool sequence() const {return m_sequence;}
+
+    // decoded frames
+    void on(std::function<void(int len, uint8_t*)> foo);
+    void proceed(const uint8_t* data, int len);
+
+    // header for datagram, out must hold UDP_DATAGRAM_SEQ_SIZE bytes
+    static void writeHeader(uint8_t* out, uint32_t seq);
+
+    inline const DatagramReaderStats& stats() const {return m_stats;}
+    inline void resetStats() {m_stats = DatagramReaderStats();}
+
+private:
+    FrameDecoder m_decoder;
+    bool m_sequence = false;
+    uint32_t m_seqExpected = 0;
+    bool m_seqValid = false;
+
+    DatagramReaderStats m_stats;
+};
+
+#endif /* UDP_DATAGRAM_H */
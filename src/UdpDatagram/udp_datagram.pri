@@ -0,0 +1,10 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD	
+
+SOURCES += \
+    $$PWD/udp_datagram.cpp \
+    $$PWD/udp_datagram_test.cpp
+
+HEADERS += \
+    $$PWD/udp_datagram.h \
+    $$PWD/udp_datagram_test.h
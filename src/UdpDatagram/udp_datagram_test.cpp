@@ -0,0 +1,145 @@
+// TEST: g++ -O2 -Wall -Wextra -I../TestUtil -I../FrameCodec -DUDP_DATAGRAM_TEST_MAIN ../FrameCodec/crc8.cpp ../FrameCodec/frame_codec.cpp udp_datagram.cpp udp_datagram_test.cpp -o udp_datagram_test && ./udp_datagram_test
+#include "udp_datagram_test.h"
+#include "udp_datagram.h"
+#include "test_util.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct Received
+{
+    int frames = 0;
+    std::vector<uint8_t> last;
+};
+
+static void listen(DatagramReader& reader, Received& received)
+{
+    reader.on([&received](int len, uint8_t* data) {
+        ++received.frames;
+        received.last.assign(data, data + len);
+    });
+}
+
+// frame of UDP_DATAGRAM_SEQ_MARK bytes: every split point starts continuation with 'S'
+static int encodeMarkFrame(std::vector<uint8_t>& payload, std::vector<uint8_t>& encoded)
+{
+    payload.assign(300, UDP_DATAGRAM_SEQ_MARK);
+    encoded.resize(FRAME_CODEC_ENCODED_SIZE(payload.size()));
+    const int size = FrameEncoder::encode(static_cast<int>(payload.size()), payload.data(), encoded.data());
+    encoded.resize(size > 0 ? size : 0);
+    return size;
+}
+
+// datagram = optional header + part of encoded stream
+static std::vector<uint8_t> datagram(bool sequence, uint32_t seq, const uint8_t* data, int len)
+{
+    std::vector<uint8_t> out(sequence ? UDP_DATAGRAM_SEQ_SIZE : 0);
+    if (sequence) {
+        DatagramReader::writeHeader(out.data(), seq);
+    }
+    out.insert(out.end(), data, data + len);
+    return out;
+}
+
+static void testSplitWithoutSequence()
+{
+    std::vector<uint8_t> payload, encoded;
+    TEST_ASSERT("split plain: encode", encodeMarkFrame(payload, encoded) > 0);
+
+    const int cut = 100;
+    TEST_ASSERT("split plain: continuation starts with mark", encoded[cut] == UDP_DATAGRAM_SEQ_MARK);
+
+    DatagramReader reader;
+    Received received;
+    listen(reader, received);
+    std::vector<uint8_t> first = datagram(false, 0, encoded.data(), cut);
+    std::vector<uint8_t> second = datagram(false, 0, encoded.data() + cut, static_cast<int>(encoded.size()) - cut);
+    reader.proceed(first.data(), static_cast<int>(first.size()));
+    reader.proceed(second.data(), static_cast<int>(second.size()));
+
+    TEST_ASSERT("split plain: frame complete", received.frames == 1 && received.last == payload);
+    TEST_ASSERT("split plain: no header errors", reader.stats().badHeader == 0 && reader.stats().datagrams == 2);
+}
+
+static void testSplitWithSequence()
+{
+    std::vector<uint8_t> payload, encoded;
+    encodeMarkFrame(payload, encoded);
+    const int cut = 100;
+
+    DatagramReader reader;
+    reader.setSequence(true);
+    Received received;
+    listen(reader, received);
+    std::vector<uint8_t> first = datagram(true, 7, encoded.data(), cut);
+    std::vector<uint8_t> second = datagram(true, 8, encoded.data() + cut, static_cast<int>(encoded.size()) - cut);
+    reader.proceed(first.data(), static_cast<int>(first.size()));
+    reader.proceed(second.data(), static_cast<int>(second.size()));
+
+    TEST_ASSERT("split seq: frame complete", received.frames == 1 && received.last == payload);
+    TEST_ASSERT("split seq: no loss", reader.stats().lost == 0 && reader.stats().reordered == 0);
+}
+
+static void testLostPart()
+{
+    std::vector<uint8_t> payload, encoded;
+    encodeMarkFrame(payload, encoded);
+    const int cut = 100;
+
+    DatagramReader reader;
+    reader.setSequence(true);
+    Received received;
+    listen(reader, received);
+    std::vector<uint8_t> first = datagram(true, 0, encoded.data(), cut);
+    std::vector<uint8_t> second = datagram(true, 2, encoded.data() + cut, static_cast<int>(encoded.size()) - cut);
+    reader.proceed(first.data(), static_cast<int>(first.size()));
+    reader.proceed(second.data(), static_cast<int>(second.size()));
+
+    TEST_ASSERT("lost: frame dropped", received.frames == 0);
+    TEST_ASSERT("lost: gap counted", reader.stats().lost == 1);
+
+    // late datagram is counted, next frame goes through
+    reader.proceed(first.data(), static_cast<int>(first.size()));
+    TEST_ASSERT("lost: reordered counted", reader.stats().reordered == 1);
+    std::vector<uint8_t> whole = datagram(true, 3, encoded.data(), static_cast<int>(encoded.size()));
+    reader.proceed(whole.data(), static_cast<int>(whole.size()));
+    TEST_ASSERT("lost: next frame", received.frames == 1 && received.last == payload);
+}
+
+static void testMissingHeader()
+{
+    std::vector<uint8_t> payload, encoded;
+    encodeMarkFrame(payload, encoded);
+
+    DatagramReader reader;
+    reader.setSequence(true);
+    Received received;
+    listen(reader, received);
+    std::vector<uint8_t> plain = datagram(false, 0, encoded.data(), static_cast<int>(encoded.size()));
+    reader.proceed(plain.data(), static_cast<int>(plain.size()));
+
+    // plain datagram starts with SB, it is never taken as header
+    TEST_ASSERT("missing header: dropped", received.frames == 0 && reader.stats().badHeader == 1);
+}
+
+int udpDatagramTest(void)
+{
+    failCount = 0;
+    testSplitWithoutSequence();
+    testSplitWithSequence();
+    testLostPart();
+    testMissingHeader();
+
+    if (failCount == 0) {
+        printf("udp datagram: all tests passed\n");
+    }
+    return failCount;
+}
+
+#ifdef UDP_DATAGRAM_TEST_MAIN
+int main(void)
+{
+    return udpDatagramTest() ? 1 : 0;
+}
+#endif /* UDP_DATAGRAM_TEST_MAIN */
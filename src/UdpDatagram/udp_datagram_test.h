@@ -0,0 +1,7 @@
+#ifndef UDP_DATAGRAM_TEST_H
+#define UDP_DATAGRAM_TEST_H
+
+// returns count of failed checks
+int udpDatagramTest(void);
+
+#endif /* UDP_DATAGRAM_TEST_H */
@@ -0,0 +1,190 @@
+#include "UdpTransport.hpp"
+
+static_assert(UDP_TRANSPORT_MTU >= (UDP_DATAGRAM_SEQ_SIZE + FRAME_CODEC_MIN_CHUNK) * 2, "UDP_TRANSPORT_MTU too small");
+
+
+UdpTransport::UdpTransport(uint16_t localPort) :
+    m_localPort(localPort)
+{
+    m_reader.on([this](int len, uint8_t* data) {
+        m_commands.dispatch(len, data);
+    });
+}
+
+void UdpTransport::setSequence(bool enable)
+{
+    flush();
+    m_sequence = enable;
+    m_reader.setSequence(enable);
+}
+
+UdpTransportStats UdpTransport::stats() const
+{
+    UdpTransportStats stats = m_stats;
+    const DatagramReaderStats& rx = m_reader.stats();
+    stats.datagramsRx = rx.datagrams;
+    stats.bytesRx = rx.bytes;
+    stats.lost = rx.lost;
+    stats.reordered = rx.reordered;
+    stats.badHeader = rx.badHeader;
+    return stats;
+}
+
+void UdpTransport::resetStats()
+{
+    m_stats = UdpTransportStats();
+    m_reader.resetStats();
+}
+
+bool UdpTransport::begin()
+{
+    return m_udp.begin(m_localPort) != 0;
+}
+
+void UdpTransport::setRemote(IPAddress ip, uint16_t port)
+{
+    m_remoteIp = ip;
+    m_remotePort = port;
+    m_fixedRemote = true;
+}
+
+bool UdpTransport::setRemote(const char* host, uint16_t port)
+{
+    IPAddress ip;
+    if (!ip.fromString(host)) {
+        return false;
+    }
+    setRemote(ip, port);
+    return true;
+}
+
+void UdpTransport::on(uint8_t cmd, CommandHandler::Foo foo)
+{
+    m_commands.on(cmd, CommandHandler(foo));
+}
+
+void UdpTransport::on(uint8_t cmd, CommandHandler::CtxFoo foo, void* ctx)
+{
+    m_commands.on(cmd, CommandHandler(foo, ctx));
+}
+
+void UdpTransport::on(uint8_t cmd, CommandHandler handler)
+{
+    m_commands.on(cmd, handler);
+}
+
+
+// TX ---------------------------------------------------------------------------------
+void UdpTransport::write(int len, unsigned char *ptr)
+{
+    if (m_remotePort == 0) {
+        return; // nobody to send to yet
+    }
+
+    // worst case first, exact size only if worst case does not fit
+    int size = FRAME_CODEC_ENCODED_SIZE(len);
+    int used = m_txLen ? m_txLen : _headerSize();
+    if ((used + size) > UDP_TRANSPORT_MTU) {
+        size = FrameEncoder::encodedSize(len, ptr);
+        if (size < 0) {
+            return;
+        }
+
+        if (m_txLen && (m_txLen + size) > UDP_TRANSPORT_MTU) {
+            _sendDatagram();
+        }
+
+        if ((_headerSize() + size) > UDP_TRANSPORT_MTU) {
+            // never fits one datagram: every chunk goes as own datagram
+            const int header = _headerSize();
+            FrameEncoder::encode(len, ptr, m_txDatagram + header, UDP_TRANSPORT_MTU - header, [this, header](const uint8_t*, int n) {
+                _startDatagram();
+                m_txLen = header + n;
+                _sendDatagram();
+            });
+            ++m_stats.framesTx;
+            return;
+        }
+    }
+
+    if (m_txLen == 0) {
+        _startDatagram();
+    }
+
+    int pos = FrameEncoder::encode(len, ptr, m_txDatagram + m_txLen);
+    if (pos > 0) {
+        m_txLen += pos;
+        ++m_txFrames;
+    }
+}
+
+void UdpTransport::flush()
+{
+    if (m_txLen) {
+        _sendDatagram();
+    }
+}
+
+int UdpTransport::_headerSize() const
+{
+    return m_sequence ? UDP_DATAGRAM_SEQ_SIZE : 0;
+}
+
+void UdpTransport::_startDatagram()
+{
+    m_txLen = _headerSize();
+    m_txFrames = 0;
+    m_txStartUs = micros();
+}
+
+void UdpTransport::_sendDatagram()
+{
+    if (m_sequence) {
+        DatagramReader::writeHeader(m_txDatagram, m_txSeq);
+        ++m_txSeq;
+    }
+
+    if (m_udp.beginPacket(m_remoteIp, m_remotePort) && m_udp.write(m_txDatagram, m_txLen) == static_cast<size_t>(m_txLen) && m_udp.endPacket()) {
+        ++m_stats.datagramsTx;
+        m_stats.framesTx += m_txFrames;
+        m_stats.bytesTx += m_txLen;
+    } else {
+        ++m_stats.sendErrors;
+    }
+
+    m_txLen = 0;
+    m_txFrames = 0;
+}
+
+
+// RX ---------------------------------------------------------------------------------
+void UdpTransport::proceed()
+{
+    int size;
+    while ((size = m_udp.parsePacket()) > 0) {
+        _receive(size);
+    }
+
+    if (m_txLen && (micros() - m_txStartUs) >= m_deadlineUs) {
+        _sendDatagram();
+    }
+}
+
+void UdpTransport::_receive(int size)
+{
+    if (!m_fixedRemote) {
+        m_remoteIp = m_udp.remoteIP();
+        m_remotePort = m_udp.remotePort();
+    }
+
+    int len = m_udp.read(m_rxDatagram, sizeof(m_rxDatagram));
+    if (len <= 0) {
+        return;
+    }
+    if (size > len) {
+        m_udp.flush(); // bigger than MTU, rest is dropped
+    }
+
+    // header presence is configured, never guessed from first byte
+    m_reader.proceed(m_rxDatagram, len);
+}
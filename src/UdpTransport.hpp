@@ -0,0 +1,102 @@
+#ifndef UDP_TRANSPORT
+#define UDP_TRANSPORT
+
+#include <WiFiUdp.h>
+#include <IPAddress.h>
+#include "frame_codec.h"
+#include "command_table.h"
+#include "udp_datagram.h"
+
+/*
+ * UDP transport: same frames and on(cmd, ...) API as TcpClient, no head-of-line
+ * blocking and no retransmits, lost frames are just lost.
+ *
+ * Datagram:
+ *      [{UDP_DATAGRAM_SEQ_MARK}{seq >> 24}{seq >> 16}{seq >> 8}{seq}] {frame} ... {frame}
+ *
+ *  - frames are packed up to UDP_TRANSPORT_MTU, datagram goes out when next frame
+ *    does not fit, when first frame waited deadlineUs, or on flush()
+ *  - sequence header is optional (setSequence()), it is not detected by receiver:
+ *    both ends must use same setting (see DatagramReader)
+ *  - frame bigger than one datagram is streamed over several datagrams (each with
+ *    own header), loss of any part fails frame CRC
+ */
+
+#ifndef UDP_TRANSPORT_MTU
+#   define UDP_TRANSPORT_MTU 1400  // datagram payload, below 1500 byte Ethernet MTU with IP/UDP headers
+#endif /* UDP_TRANSPORT_MTU */
+
+#ifndef UDP_TRANSPORT_DEADLINE_US
+#   define UDP_TRANSPORT_DEADLINE_US 1000U
+#endif /* UDP_TRANSPORT_DEADLINE_US */
+
+struct UdpTransportStats
+{
+    uint32_t datagramsTx = 0;
+    uint32_t framesTx = 0;
+    uint32_t bytesTx = 0;
+    uint32_t sendErrors = 0;    // beginPacket()/endPacket() failed (no route, no buffers)
+
+    uint32_t datagramsRx = 0;
+    uint32_t bytesRx = 0;
+    uint32_t lost = 0;          // sequence gaps (datagrams never received)
+    uint32_t reordered = 0;     // datagrams older than expected (late or duplicated)
+    uint32_t badHeader = 0;     // sequence on, datagram without header dropped
+};
+
+class UdpTransport
+{
+public:
+    UdpTransport(uint16_t localPort);
+
+    bool begin();
+    // without remote, datagrams go to last sender
+    void setRemote(IPAddress ip, uint16_t port);
+    bool setRemote(const char* host, uint16_t port);
+
+    // both TX and RX, peer must use same setting
+    void setSequence(bool enable);
+    inline void setDeadline(unsigned int deadlineUs) {m_deadlineUs = deadlineUs;}
+
+    void write(int len, unsigned char*);
+    void flush();
+
+    void on(uint8_t cmd, CommandHandler::Foo foo);
+    void on(uint8_t cmd, CommandHandler::CtxFoo foo, void* ctx);
+    void on(uint8_t cmd, CommandHandler handler);
+
+    // read all waiting datagrams and send datagram which waited too long
+    void proceed();
+
+    UdpTransportStats stats() const;
+    void resetStats();
+
+private:
+    int _headerSize() const;
+    void _startDatagram();
+    void _sendDatagram();
+    void _receive(int size);
+
+    WiFiUDP m_udp;
+    uint16_t m_localPort;
+    IPAddress m_remoteIp;
+    uint16_t m_remotePort = 0;
+    bool m_fixedRemote = false;
+
+    DatagramReader m_reader;
+    CommandTable m_commands;
+
+    bool m_sequence = false;
+    uint32_t m_txSeq = 0;
+
+    unsigned int m_deadlineUs = UDP_TRANSPORT_DEADLINE_US;
+    unsigned long m_txStartUs = 0;
+    int m_txLen = 0;            // 0 -> no datagram started
+    int m_txFrames = 0;
+    uint8_t m_txDatagram[UDP_TRANSPORT_MTU];
+    uint8_t m_rxDatagram[UDP_TRANSPORT_MTU];
+
+    UdpTransportStats m_stats;
+};
+
+#endif /* UDP_TRANSPORT */
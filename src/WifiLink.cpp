@@ -0,0 +1,205 @@
+#include "WifiLink.hpp"
+#include <Preferences.h>
+#include <string.h>
+
+
+void WifiLink::setStaticIp(IPAddress ip, IPAddress gateway, IPAddress mask, IPAddress dns)
+{
+    m_static = true;
+    m_ip = ip;
+    m_gateway = gateway;
+    m_mask = mask;
+    m_dns = dns;
+}
+
+void WifiLink::begin(const char* ssid, const char* password)
+{
+    m_ssid = ssid;
+    m_password = password;
+
+    // reconnects and credentials are handled here, SDK must not write flash on every begin()
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);
+
+    if (!m_eventsOn) {
+        m_eventsOn = true;
+        WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t) {
+            _event(event);
+        });
+    }
+
+    _load();
+    m_connectStart = millis();
+    _startFast(m_connectStart);
+}
+
+void WifiLink::onChange(std::function<void(bool up)> foo)
+{
+    m_onChange = foo;
+}
+
+// Wi-Fi event task
+void WifiLink::_event(arduino_event_id_t event)
+{
+    switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        m_up = true;
+        break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+        m_up = false;
+        break;
+    default:
+        return;
+    }
+    ++m_stats.events;
+}
+
+bool WifiLink::proceed(uint32_t timeMs)
+{
+    const bool up = m_up;
+
+    switch (m_state) {
+    case STATE_CONNECTED:
+        if (up) {
+            return true;
+        }
+        ++m_stats.disconnects;
+        m_connectStart = timeMs;
+        _startFast(timeMs);
+        if (m_onChange) {
+            m_onChange(false);
+        }
+        break;
+
+    case STATE_FAST:
+        if (up) {
+            ++m_stats.fastConnects;
+            _connected(timeMs);
+            return true;
+        }
+        if ((timeMs - m_stateTime) > WIFI_LINK_FAST_TIMEOUT_MS) {
+            ++m_stats.fastMisses;
+            forget();
+            _startFull(timeMs);
+        }
+        break;
+
+    case STATE_FULL:
+        if (up) {
+            ++m_stats.fullConnects;
+            _connected(timeMs);
+            return true;
+        }
+        if ((timeMs - m_stateTime) > WIFI_LINK_FULL_TIMEOUT_MS) {
+            _startFull(timeMs);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+void WifiLink::forget()
+{
+    m_cacheValid = false;
+
+    Preferences prefs;
+    if (prefs.begin(WIFI_LINK_NVS_NAMESPACE, false)) {
+        prefs.remove("cache");
+        prefs.end();
+    }
+}
+
+void WifiLink::_startFast(uint32_t timeMs)
+{
+    if (!m_cacheValid) {
+        _startFull(timeMs);
+        return;
+    }
+
+    if (m_static) {
+        WiFi.config(m_ip, m_gateway, m_mask, m_dns);
+    } else if (m_leaseReuse && m_cache.ip) {
+        WiFi.config(IPAddress(m_cache.ip), IPAddress(m_cache.gateway), IPAddress(m_cache.mask), IPAddress(m_cache.dns));
+    } else {
+        WiFi.config(IPAddress(), IPAddress(), IPAddress()); // DHCP
+    }
+
+    WiFi.begin(m_ssid, m_password, m_cache.channel, m_cache.bssid, true);
+    m_state = STATE_FAST;
+    m_stateTime = timeMs;
+}
+
+void WifiLink::_startFull(uint32_t timeMs)
+{
+    WiFi.disconnect();
+    m_up = false;
+    if (m_static) {
+        WiFi.config(m_ip, m_gateway, m_mask, m_dns);
+    } else {
+        WiFi.config(IPAddress(), IPAddress(), IPAddress()); // DHCP
+    }
+
+    WiFi.begin(m_ssid, m_password);
+    m_state = STATE_FULL;
+    m_stateTime = timeMs;
+}
+
+void WifiLink::_connected(uint32_t timeMs)
+{
+    m_state = STATE_CONNECTED;
+    m_stats.connectMs = timeMs - m_connectStart;
+    if (!m_stats.firstConnectMs) {
+        m_stats.firstConnectMs = timeMs;
+    }
+    _save();
+
+    if (m_onChange) {
+        m_onChange(true);
+    }
+}
+
+
+// NVS cache ------------------------------------------------------------------------
+void WifiLink::_load()
+{
+    Preferences prefs;
+    if (!prefs.begin(WIFI_LINK_NVS_NAMESPACE, true)) {
+        return;
+    }
+    m_cacheValid = prefs.getBytes("cache", &m_cache, sizeof(m_cache)) == sizeof(m_cache) && m_cache.channel != 0;
+    prefs.end();
+}
+
+void WifiLink::_save()
+{
+    Cache cache;
+    memset(&cache, 0, sizeof(cache));
+    memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+    cache.channel = static_cast<uint8_t>(WiFi.channel());
+    cache.ip = static_cast<uint32_t>(WiFi.localIP());
+    cache.gateway = static_cast<uint32_t>(WiFi.gatewayIP());
+    cache.mask = static_cast<uint32_t>(WiFi.subnetMask());
+    cache.dns = static_cast<uint32_t>(WiFi.dnsIP());
+
+    // flash wear: write only what changed
+    if (m_cacheValid && memcmp(&cache, &m_cache, sizeof(cache)) == 0) {
+        return;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(WIFI_LINK_NVS_NAMESPACE, false)) {
+        return;
+    }
+    if (prefs.putBytes("cache", &cache, sizeof(cache)) == sizeof(cache)) {
+        m_cache = cache;
+        m_cacheValid = true;
+        ++m_stats.cacheWrites;
+    }
+    prefs.end();
+}
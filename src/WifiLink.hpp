@@ -0,0 +1,103 @@
+#ifndef WIFI_LINK
+#define WIFI_LINK
+
+#include <WiFi.h>
+#include <IPAddress.h>
+
+/*
+ * Wi-Fi station with fast start, driven from loop() without blocking:
+ *
+ *  - last BSSID, channel and IP lease are kept in NVS (WIFI_LINK_NVS_NAMESPACE), written
+ *    only when they change
+ *  - fast path: WiFi.begin() with cached BSSID/channel (no scan), cached lease is used as
+ *    static config (no DHCP) if lease reuse is on, or static IP from setStaticIp()
+ *  - if fast path does not connect in WIFI_LINK_FAST_TIMEOUT_MS, cache is dropped and
+ *    full scan + DHCP is used, it is restarted every WIFI_LINK_FULL_TIMEOUT_MS
+ *  - lost connection goes to fast path again
+ *  - link state comes from Wi-Fi events (got IP / disconnected / lost IP) set by event
+ *    task, proceed() only reads flag, onChange() handlers run from proceed() (loop context)
+ *
+ * Lease reuse is off by default (setLeaseReuse(true) or -D WIFI_LINK_REUSE_LEASE=true):
+ * it skips DHCP, so lease is never renewed with server. Use it only where DHCP server
+ * keeps address for same MAC for good (reservation), otherwise address may be given to
+ * other host after lease expires and IP conflict goes unnoticed.
+ */
+
+#define WIFI_LINK_NVS_NAMESPACE "wifi_link"
+#define WIFI_LINK_FAST_TIMEOUT_MS 3000U
+#define WIFI_LINK_FULL_TIMEOUT_MS 15000U
+
+#ifndef WIFI_LINK_REUSE_LEASE
+#   define WIFI_LINK_REUSE_LEASE false
+#endif /* WIFI_LINK_REUSE_LEASE */
+
+struct WifiLinkStats
+{
+    uint32_t firstConnectMs = 0;    // millis() when first connected after boot
+    uint32_t connectMs = 0;         // last connect duration, from begin() or link loss
+    uint32_t fastConnects = 0;      // connected by cached BSSID/channel
+    uint32_t fastMisses = 0;        // cache did not work, full scan was used
+    uint32_t fullConnects = 0;
+    uint32_t disconnects = 0;
+    uint32_t cacheWrites = 0;       // NVS writes
+    uint32_t events = 0;            // Wi-Fi events handled
+};
+
+class WifiLink
+{
+public:
+    // static config, used on every connect instead of DHCP and cached lease
+    void setStaticIp(IPAddress ip, IPAddress gateway, IPAddress mask, IPAddress dns = IPAddress());
+    inline void setLeaseReuse(bool reuse) {m_leaseReuse = reuse;}
+
+    void begin(const char* ssid, const char* password);
+    // call from loop(), returns true while connected
+    bool proceed(uint32_t timeMs);
+
+    inline bool connected() const {return m_state == STATE_CONNECTED;}
+    // up / down transitions, called from proceed()
+    void onChange(std::function<void(bool up)> foo);
+    inline const WifiLinkStats& stats() const {return m_stats;}
+
+    // drop cached BSSID/channel/lease, next connect goes through full scan
+    void forget();
+
+private:
+    enum State { STATE_IDLE, STATE_FAST, STATE_FULL, STATE_CONNECTED };
+
+    struct Cache {
+        uint8_t bssid[6];
+        uint8_t channel;
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t mask;
+        uint32_t dns;
+    };
+
+    void _startFast(uint32_t timeMs);
+    void _startFull(uint32_t timeMs);
+    void _connected(uint32_t timeMs);
+    void _event(arduino_event_id_t event);
+    void _load();
+    void _save();
+
+    const char* m_ssid = nullptr;
+    const char* m_password = nullptr;
+    State m_state = STATE_IDLE;
+    volatile bool m_up = false;     // set by Wi-Fi event task
+    bool m_eventsOn = false;
+    std::function<void(bool up)> m_onChange = nullptr;
+    uint32_t m_stateTime = 0;       // current attempt start
+    uint32_t m_connectStart = 0;    // begin() or link loss
+
+    bool m_static = false;
+    IPAddress m_ip, m_gateway, m_mask, m_dns;
+    bool m_leaseReuse = WIFI_LINK_REUSE_LEASE;
+
+    Cache m_cache;
+    bool m_cacheValid = false;
+
+    WifiLinkStats m_stats;
+};
+
+#endif /* WIFI_LINK */
@@ -0,0 +1,141 @@
+#include "WsTransport.hpp"
+#include <string.h>
+
+static_assert((1 + WS_TRANSPORT_RX_CHUNK) <= SpscFrameRing<WS_TRANSPORT_RX_QUEUE>::maxFrame, "WS_TRANSPORT_RX_CHUNK does not fit rx queue");
+
+
+WsTransport::WsTransport(uint16_t port, const char* path) :
+    m_server(port),
+    m_ws(path)
+{
+    m_decoder.on([this](int len, uint8_t* data) {
+        m_commands.dispatch(len, data);
+    });
+}
+
+void WsTransport::begin()
+{
+    m_ws.onEvent([this](AsyncWebSocket*, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len) {
+        _onEvent(client, type, arg, data, len);
+    });
+    m_server.addHandler(&m_ws);
+    m_server.begin();
+}
+
+void WsTransport::on(uint8_t cmd, CommandHandler::Foo foo)
+{
+    m_commands.on(cmd, CommandHandler(foo));
+}
+
+void WsTransport::on(uint8_t cmd, CommandHandler::CtxFoo foo, void* ctx)
+{
+    m_commands.on(cmd, CommandHandler(foo, ctx));
+}
+
+void WsTransport::on(uint8_t cmd, CommandHandler handler)
+{
+    m_commands.on(cmd, handler);
+}
+
+
+// TX ---------------------------------------------------------------------------------
+void WsTransport::write(int len, unsigned char *ptr)
+{
+    // worst case first, exact size only if worst case does not fit
+    int size = FRAME_CODEC_ENCODED_SIZE(len);
+    if ((m_txLen + size) > WS_TRANSPORT_BATCH_SIZE) {
+        size = FrameEncoder::encodedSize(len, ptr);
+        if (size < 0) {
+            return;
+        }
+        if ((m_txLen + size) > WS_TRANSPORT_BATCH_SIZE) {
+            flush();
+        }
+    }
+
+    int pos = FrameEncoder::encode(len, ptr, m_txBatch + m_txLen);
+    if (pos <= 0) {
+        return;
+    }
+
+    if (m_txLen == 0) {
+        m_txStartUs = micros();
+    }
+    m_txLen += pos;
+    ++m_txFrames;
+}
+
+void WsTransport::flush()
+{
+    if (m_txLen == 0) {
+        return;
+    }
+
+    if (m_ws.count()) {
+        // copied once to shared message buffer and queued for every client
+        m_ws.binaryAll(m_txBatch, m_txLen);
+        ++m_stats.messagesTx;
+        m_stats.framesTx += m_txFrames;
+        m_stats.bytesTx += m_txLen;
+    } else {
+        ++m_stats.noClients;
+    }
+
+    m_txLen = 0;
+    m_txFrames = 0;
+}
+
+void WsTransport::proceed()
+{
+    int len;
+    while ((len = m_rxQueue.pop(m_rxEntry, sizeof(m_rxEntry))) > 0) {
+        if (m_rxEntry[0] & RX_FIRST) {
+            m_decoder.reset(); // message starts with new frame
+        }
+        m_decoder.proceed(m_rxEntry + 1, len - 1);
+    }
+
+    if (m_txLen && (micros() - m_txStartUs) >= WS_TRANSPORT_DEADLINE_US) {
+        flush();
+    }
+
+    if ((millis() - m_cleanupTime) > WS_TRANSPORT_CLEANUP_MS) {
+        m_cleanupTime = millis();
+        m_ws.cleanupClients();
+    }
+}
+
+
+// RX, AsyncTCP task -------------------------------------------------------------------
+void WsTransport::_onEvent(AsyncWebSocketClient*, AwsEventType type, void* arg, uint8_t* data, size_t len)
+{
+    if (type != WS_EVT_DATA) {
+        return;
+    }
+
+    const AwsFrameInfo* info = static_cast<const AwsFrameInfo*>(arg);
+    const bool binary = info->opcode == WS_BINARY || (info->opcode == WS_CONTINUATION && info->message_opcode == WS_BINARY);
+    if (!binary) {
+        return;
+    }
+
+    if (info->index == 0 && info->final) {
+        m_stats.messagesRx = m_stats.messagesRx + 1;
+    }
+
+    // big message comes in several parts, split them to ring entries
+    bool first = info->index == 0 && (info->opcode == WS_BINARY);
+    while (len) {
+        size_t n = len < WS_TRANSPORT_RX_CHUNK ? len : WS_TRANSPORT_RX_CHUNK;
+        m_rxPart[0] = first ? RX_FIRST : 0;
+        memcpy(m_rxPart + 1, data, n);
+
+        if (!m_rxQueue.push(m_rxPart, static_cast<uint32_t>(n + 1))) {
+            m_stats.rxDropped = m_stats.rxDropped + 1;
+            return;
+        }
+        data += n;
+        len -= n;
+        first = false;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef WS_TRANSPORT
+#define WS_TRANSPORT
+
+#include <ESPAsyncWebServer.h>
+#include "frame_codec.h"
+#include "command_table.h"
+#include "spsc_ring.h"
+
+/*
+ * WebSocket endpoint (ESPAsyncWebServer): same frames and on(cmd, ...) API as
+ * TcpClient, carried in binary messages, so browser dashboards can subscribe directly.
+ *
+ *  - every binary message holds one or more whole frames
+ *  - TX: write() packs frames into one message, proceed() hands it to all clients
+ *    with binaryAll() (one shared buffer, queued per client, never waits for socket;
+ *    client with full queue loses message)
+ *  - RX: AsyncTCP task only copies message data to lock-free ring, frames are decoded
+ *    and dispatched in proceed() caller task, so handlers run in same task as for TcpClient
+ */
+
+#define WS_TRANSPORT_BATCH_SIZE FRAME_CODEC_ENCODED_SIZE(FRAME_CODEC_MAX_PAYLOAD) // any frame fits
+
+#ifndef WS_TRANSPORT_DEADLINE_US
+#   define WS_TRANSPORT_DEADLINE_US 2000U
+#endif /* WS_TRANSPORT_DEADLINE_US */
+
+// AsyncTCP task -> proceed() (power of two)
+#ifndef WS_TRANSPORT_RX_QUEUE
+#   define WS_TRANSPORT_RX_QUEUE 8192U
+#endif /* WS_TRANSPORT_RX_QUEUE */
+
+#define WS_TRANSPORT_RX_CHUNK 1024 // message data per ring entry
+#define WS_TRANSPORT_CLEANUP_MS 1000U
+
+struct WsTransportStats
+{
+    uint32_t messagesTx = 0;
+    uint32_t framesTx = 0;
+    uint32_t bytesTx = 0;
+    uint32_t noClients = 0;     // messages dropped because nobody was connected
+
+    volatile uint32_t messagesRx = 0;
+    volatile uint32_t rxDropped = 0; // rx queue was full
+};
+
+class WsTransport
+{
+public:
+    WsTransport(uint16_t port, const char* path = "/ws");
+
+    void begin();
+    void write(int len, unsigned char*);
+    void flush();
+
+    void on(uint8_t cmd, CommandHandler::Foo foo);
+    void on(uint8_t cmd, CommandHandler::CtxFoo foo, void* ctx);
+    void on(uint8_t cmd, CommandHandler handler);
+
+    // decode received messages, send message which waited too long, drop dead clients
+    void proceed();
+
+    inline int clientCount() {return static_cast<int>(m_ws.count());}
+    inline const WsTransportStats& stats() const {return m_stats;}
+
+private:
+    // ring entry: {flags}{data}
+    enum RxFlags : uint8_t { RX_FIRST = 1 };
+
+    void _onEvent(AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t len);
+
+    AsyncWebServer m_server;
+    AsyncWebSocket m_ws;
+    FrameDecoder m_decoder;
+    CommandTable m_commands;
+
+    SpscFrameRing<WS_TRANSPORT_RX_QUEUE> m_rxQueue;
+    uint8_t m_rxEntry[1 + WS_TRANSPORT_RX_CHUNK];
+    uint8_t m_rxPart[1 + WS_TRANSPORT_RX_CHUNK]; // AsyncTCP task only
+
+    uint8_t m_txBatch[WS_TRANSPORT_BATCH_SIZE];
+    int m_txLen = 0;
+    int m_txFrames = 0;
+    unsigned long m_txStartUs = 0;
+    unsigned long m_cleanupTime = 0;
+
+    WsTransportStats m_stats;
+};
+
+#endif /* WS_TRANSPORT */
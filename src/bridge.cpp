@@ -0,0 +1,186 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "bridge.hpp"
+
+
+Bridge::Bridge(Kuart& kuart, TcpClient& client) :
+    m_kuart(kuart),
+    m_client(client)
+{
+
+}
+
+bool Bridge::begin(const uint16_t port, const char * host, bool raw)
+{
+    m_port = port;
+    m_host = host;
+    m_raw = raw;
+
+    auto uartHandler = [this](int len, uint8_t* data) {
+        toTcp(len, data);
+    };
+
+    if (raw) {
+        m_kuart.setRaw(true);
+        m_kuart.onRaw(uartHandler);
+        m_client.setRaw(true);
+        m_client.onRaw([this](int len, uint8_t* data) {
+            toUart(len, data);
+        });
+    } else {
+        m_kuart.on(uartHandler);
+    }
+
+    if (xTaskCreatePinnedToCore(_uartTask, "bridge_uart", BRIDGE_TASK_STACK, this, BRIDGE_UART_TASK_PRIO, &m_uartTask, BRIDGE_UART_CORE) != pdPASS) {
+        return false;
+    }
+
+    if (xTaskCreatePinnedToCore(_tcpTask, "bridge_tcp", BRIDGE_TASK_STACK, this, BRIDGE_TCP_TASK_PRIO, &m_tcpTask, BRIDGE_TCP_CORE) != pdPASS) {
+        return false;
+    }
+
+    return true;
+}
+
+void Bridge::toTcp(int len, uint8_t* data)
+{
+    _push(m_uartToTcp, m_uartToTcpCounters, m_tcpTask, len, data);
+}
+
+void Bridge::toUart(int len, uint8_t* data)
+{
+    _push(m_tcpToUart, m_tcpToUartCounters, m_uartTask, len, data);
+}
+
+void Bridge::_push(Queue& queue, Counters& counters, TaskHandle_t consumer, int len, uint8_t* data)
+{
+    bool pushed = false;
+
+    switch (m_policy) {
+    case BRIDGE_DROP_OLDEST: {
+        uint32_t dropped = 0;
+        pushed = queue.pushOverwrite(data, len, &dropped);
+        counters.dropped = counters.dropped + dropped;
+        break;
+    }
+
+    case BRIDGE_BLOCK: {
+        TickType_t start = xTaskGetTickCount();
+        while (!(pushed = queue.push(data, len))) {
+            if ((xTaskGetTickCount() - start) > pdMS_TO_TICKS(BRIDGE_BLOCK_TIMEOUT_MS)) {
+                break;
+            }
+            if (consumer) {
+                xTaskNotifyGive(consumer);
+            }
+            vTaskDelay(1);
+        }
+        break;
+    }
+
+    default:
+        pushed = queue.push(data, len);
+        break;
+    }
+
+    if (pushed) {
+        counters.frames = counters.frames + 1;
+        if (consumer) {
+            xTaskNotifyGive(consumer);
+        }
+    } else {
+        counters.dropped = counters.dropped + 1;
+    }
+}
+
+BridgeQueueStats Bridge::uartToTcpStats() const
+{
+    return _stats(m_uartToTcp, m_uartToTcpCounters);
+}
+
+BridgeQueueStats Bridge::tcpToUartStats() const
+{
+    return _stats(m_tcpToUart, m_tcpToUartCounters);
+}
+
+BridgeQueueStats Bridge::_stats(const Queue& queue, const Counters& counters) const
+{
+    BridgeQueueStats stats;
+    stats.frames = counters.frames;
+    stats.dropped = counters.dropped;
+    stats.highWater = queue.highWater();
+    stats.size = queue.capacity();
+    return stats;
+}
+
+
+// tasks ---------------------------------------------------------------------------
+void Bridge::_uartTask(void* arg)
+{
+    static_cast<Bridge*>(arg)->_uartLoop();
+}
+
+void Bridge::_tcpTask(void* arg)
+{
+    static_cast<Bridge*>(arg)->_tcpLoop();
+}
+
+void Bridge::_uartLoop()
+{
+    for (;;) {
+        // RX: decoded frames go to toTcp()
+        m_kuart.proceed();
+
+        // TX: frames from host
+        int len;
+        while ((len = m_tcpToUart.pop(m_uartFrame, sizeof(m_uartFrame))) >= 0) {
+            if (m_raw) {
+                m_kuart.writeRaw(len, m_uartFrame);
+            } else {
+                m_kuart.write(len, m_uartFrame);
+            }
+        }
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BRIDGE_IDLE_WAIT_MS));
+    }
+}
+
+void Bridge::_tcpLoop()
+{
+    for (;;) {
+        // RX: decoded frames go to client handlers -> toUart()
+        // no connect attempts without Wi-Fi, backoff would grow before network is up
+        if (WiFi.status() == WL_CONNECTED) {
+            m_clientStatus = m_client.clientAutoProceedNonBlock(millis(), m_port, m_host);
+        } else {
+            m_clientStatus = CLIENT_TRY_CONNECT;
+        }
+
+        // TX: frames stay in queue while there is no connection or client TX queue is full,
+        // so queue drop policy applies to them (client would drop whole frames on its own)
+        if (m_clientStatus == CLIENT_OK || m_clientStatus == CLIENT_CONNECTED) {
+            for (;;) {
+                if (m_tcpPendingLen < 0) {
+                    m_tcpPendingLen = m_uartToTcp.pop(m_tcpFrame, sizeof(m_tcpFrame));
+                    if (m_tcpPendingLen < 0) {
+                        break;
+                    }
+                }
+
+                const uint32_t need = m_raw ? m_tcpPendingLen : FRAME_CODEC_ENCODED_SIZE(m_tcpPendingLen);
+                if (m_client.txFree() < need) {
+                    break;
+                }
+
+                if (m_raw) {
+                    m_client.writeRaw(m_tcpPendingLen, m_tcpFrame);
+                } else {
+                    m_client.write(m_tcpPendingLen, m_tcpFrame);
+                }
+                m_tcpPendingLen = -1;
+            }
+        }
+
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BRIDGE_IDLE_WAIT_MS));
+    }
+}
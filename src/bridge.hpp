@@ -0,0 +1,104 @@
+#ifndef BRIDGE_H
+#define BRIDGE_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "kuart.hpp"
+#include "TcpClient.hpp"
+#include "spsc_ring.h"
+
+/*
+ * Task based bridge: UART RX/decoding and TCP I/O run in own FreeRTOS tasks on
+ * different cores, frames go between them through lock-free SPSC queues, so
+ * Wi-Fi stall or blocking connect() never stops UART draining.
+ *
+ *  UART task (BRIDGE_UART_CORE): kuart.proceed() -> toTcp() -> [uartToTcp] ; [tcpToUart] -> kuart.write()
+ *  TCP task  (BRIDGE_TCP_CORE) : client.clientAutoProceedNonBlock() -> toUart() -> [tcpToUart] ; [uartToTcp] -> client.write()
+ *
+ * Raw mode (begin(..., true)): both sides are switched to raw mode, queue entries are
+ * raw read chunks instead of frames and go out with writeRaw().
+ */
+
+// bytes per direction (power of two), every frame takes 2 bytes + payload
+#ifndef BRIDGE_QUEUE_SIZE
+#   define BRIDGE_QUEUE_SIZE 8192U
+#endif /* BRIDGE_QUEUE_SIZE */
+
+#define BRIDGE_UART_CORE 1
+#define BRIDGE_TCP_CORE 0           // same core as Wi-Fi and lwIP
+#define BRIDGE_TASK_STACK 4096U
+#define BRIDGE_UART_TASK_PRIO 5
+#define BRIDGE_TCP_TASK_PRIO 4
+#define BRIDGE_IDLE_WAIT_MS 1U      // task sleep if there is nothing to do
+#define BRIDGE_BLOCK_TIMEOUT_MS 20U // max producer wait in BRIDGE_BLOCK mode, then frame is dropped
+
+enum BridgeDropPolicy
+{
+    BRIDGE_DROP_NEWEST = 0, // new frame is dropped if queue is full
+    BRIDGE_DROP_OLDEST,     // oldest frames are dropped to free space
+    BRIDGE_BLOCK            // producer waits for space up to BRIDGE_BLOCK_TIMEOUT_MS
+};
+
+struct BridgeQueueStats
+{
+    uint32_t frames = 0;    // frames pushed to queue
+    uint32_t dropped = 0;   // frames lost because of full queue
+    uint32_t highWater = 0; // max queue usage, bytes
+    uint32_t size = 0;      // queue size, bytes
+};
+
+class Bridge
+{
+public:
+    Bridge(Kuart& kuart, TcpClient& client);
+
+    bool begin(const uint16_t port, const char * host, bool raw = false);
+    inline void setDropPolicy(BridgeDropPolicy policy) {m_policy = policy;}
+
+    // producers: toTcp() from kuart handler (UART task), toUart() from client handlers (TCP task)
+    void toTcp(int len, uint8_t* data);
+    void toUart(int len, uint8_t* data);
+
+    BridgeQueueStats uartToTcpStats() const;
+    BridgeQueueStats tcpToUartStats() const;
+    inline int clientStatus() const {return m_clientStatus;}
+
+private:
+    typedef SpscFrameRing<BRIDGE_QUEUE_SIZE> Queue;
+
+    struct Counters {
+        volatile uint32_t frames = 0;
+        volatile uint32_t dropped = 0;
+    };
+
+    void _push(Queue& queue, Counters& counters, TaskHandle_t consumer, int len, uint8_t* data);
+    BridgeQueueStats _stats(const Queue& queue, const Counters& counters) const;
+
+    static void _uartTask(void* arg);
+    static void _tcpTask(void* arg);
+    void _uartLoop();
+    void _tcpLoop();
+
+    Kuart& m_kuart;
+    TcpClient& m_client;
+    uint16_t m_port = 0;
+    const char * m_host = nullptr;
+
+    BridgeDropPolicy m_policy = BRIDGE_DROP_NEWEST;
+    bool m_raw = false;
+    volatile int m_clientStatus = CLIENT_ERROR_CONNECTION;
+
+    TaskHandle_t m_uartTask = nullptr;
+    TaskHandle_t m_tcpTask = nullptr;
+
+    Queue m_uartToTcp;
+    Queue m_tcpToUart;
+    Counters m_uartToTcpCounters;
+    Counters m_tcpToUartCounters;
+
+    uint8_t m_uartFrame[FRAME_CODEC_MAX_PAYLOAD];
+    uint8_t m_tcpFrame[FRAME_CODEC_MAX_PAYLOAD];
+    int m_tcpPendingLen = -1;   // frame in m_tcpFrame waits for space in client TX queue
+};
+
+#endif /* BRIDGE_H */
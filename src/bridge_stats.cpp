@@ -0,0 +1,188 @@
+#include <Arduino.h>
+#include "bridge_stats.hpp"
+#include "convert.h"
+#include <string.h>
+
+
+BridgeStats::BridgeStats(Kuart& kuart, TcpClient& client) :
+    m_kuart(kuart),
+    m_client(client)
+{
+
+}
+
+void BridgeStats::attach()
+{
+    m_client.on(BRIDGE_STATS_CMD, CommandHandler::bind<BridgeStats, &BridgeStats::request>(this));
+    m_client.on(BRIDGE_CLOCK_CMD, CommandHandler::bind<BridgeStats, &BridgeStats::clockSync>(this));
+}
+
+static void addLatency(StatsHistogram& histogram, uint32_t& maxUs, unsigned long fromUs)
+{
+    const uint32_t us = static_cast<uint32_t>(micros() - fromUs);
+    histogram.add(us);
+    if (us > maxUs) {
+        maxUs = us;
+    }
+}
+
+void BridgeStats::toTcp(int len, uint8_t* data)
+{
+    toTcp(len, data, m_kuart.frameTimeUs());
+}
+
+void BridgeStats::toTcp(int len, uint8_t* data, unsigned long decodedUs)
+{
+    if (m_trailer) {
+        // frame without trailer would look like shorter one with it
+        if (len > BRIDGE_CLOCK_MAX_PAYLOAD) {
+            ++m_trailerDropped;
+            return;
+        }
+        unsigned int pos = static_cast<unsigned int>(len);
+        memcpy(m_frame, data, len);
+        Convert::FB::writeU32(m_frame, &pos, decodedUs);
+        m_client.write(static_cast<int>(pos), m_frame);
+    } else {
+        m_client.write(len, data);
+    }
+
+    addLatency(m_uartToTcpUs, m_uartToTcpMaxUs, decodedUs);
+}
+
+void BridgeStats::toUart(int len, uint8_t* data)
+{
+    m_kuart.write(len, data);
+    addLatency(m_tcpToUartUs, m_tcpToUartMaxUs, m_client.frameTimeUs());
+}
+
+void BridgeStats::loopTick()
+{
+    const unsigned long now = micros();
+    if (m_ticked) {
+        const uint32_t loopUs = static_cast<uint32_t>(now - m_lastTickUs);
+        m_loopUs.add(loopUs);
+        if (loopUs > m_loopMaxUs) {
+            m_loopMaxUs = loopUs;
+        }
+        ++m_iterations;
+    }
+    m_lastTickUs = now;
+    m_ticked = true;
+
+    m_txDepth.add(m_client.txStats().pending);
+}
+
+int BridgeStats::record(uint8_t* out, unsigned int size) const
+{
+    if (size < BRIDGE_STATS_RECORD_SIZE) {
+        return -1;
+    }
+
+    unsigned int pos = 0;
+    Convert::FB::writeU8(out, &pos, BRIDGE_STATS_CMD);
+    Convert::FB::writeU8(out, &pos, BRIDGE_STATS_VERSION);
+    Convert::FB::writeU32(out, &pos, millis());
+
+    const KuartStats& uart = m_kuart.stats();
+    const FrameDecoderStats& uartDecoder = m_kuart.decoderStats();
+    const KuartRxCounters& uartRx = m_kuart.rxCounters();
+    Convert::FB::writeU32(out, &pos, uart.bytesIn);
+    Convert::FB::writeU32(out, &pos, uartDecoder.frames);
+    Convert::FB::writeU32(out, &pos, uart.bytesOut);
+    Convert::FB::writeU32(out, &pos, uart.framesOut);
+    Convert::FB::writeU32(out, &pos, uartDecoder.crcErrors);
+    Convert::FB::writeU32(out, &pos, uartDecoder.resyncs);
+    Convert::FB::writeU32(out, &pos, uartDecoder.oversize);
+    Convert::FB::writeU32(out, &pos, uartRx.fifoOverflows);
+    Convert::FB::writeU32(out, &pos, uartRx.bufferFull);
+    Convert::FB::writeU32(out, &pos, uartRx.highWater);
+
+    const TcpClientStats& tcp = m_client.stats();
+    const FrameDecoderStats& tcpDecoder = m_client.decoderStats();
+    const TcpTxQueueStats tx = m_client.txStats();
+    Convert::FB::writeU32(out, &pos, tcp.bytesIn);
+    Convert::FB::writeU32(out, &pos, tcpDecoder.frames);
+    Convert::FB::writeU32(out, &pos, tcp.bytesOut);
+    Convert::FB::writeU32(out, &pos, tcp.framesOut);
+    Convert::FB::writeU32(out, &pos, tcpDecoder.crcErrors);
+    Convert::FB::writeU32(out, &pos, tcpDecoder.resyncs);
+    Convert::FB::writeU32(out, &pos, tcpDecoder.oversize);
+    Convert::FB::writeU32(out, &pos, tcp.connects);
+    Convert::FB::writeU32(out, &pos, tcp.disconnects);
+    Convert::FB::writeU32(out, &pos, tx.dropped);
+    Convert::FB::writeU32(out, &pos, tx.pending);
+    Convert::FB::writeU32(out, &pos, tx.highWater);
+
+    Convert::FB::writeU32(out, &pos, m_iterations);
+    Convert::FB::writeU32(out, &pos, m_loopMaxUs);
+    for (unsigned int i = 0; i < BRIDGE_STATS_BINS; ++i) {
+        Convert::FB::writeU32(out, &pos, m_loopUs.bins[i]);
+    }
+    for (unsigned int i = 0; i < BRIDGE_STATS_BINS; ++i) {
+        Convert::FB::writeU32(out, &pos, m_txDepth.bins[i]);
+    }
+
+    Convert::FB::writeU32(out, &pos, m_uartToTcpMaxUs);
+    Convert::FB::writeU32(out, &pos, m_tcpToUartMaxUs);
+    for (unsigned int i = 0; i < BRIDGE_STATS_BINS; ++i) {
+        Convert::FB::writeU32(out, &pos, m_uartToTcpUs.bins[i]);
+    }
+    for (unsigned int i = 0; i < BRIDGE_STATS_BINS; ++i) {
+        Convert::FB::writeU32(out, &pos, m_tcpToUartUs.bins[i]);
+    }
+    Convert::FB::writeU32(out, &pos, m_trailerDropped);
+
+    return static_cast<int>(pos);
+}
+
+void BridgeStats::reset()
+{
+    m_kuart.resetStats();
+    m_client.resetStats();
+    m_iterations = 0;
+    m_loopMaxUs = 0;
+    m_loopUs = StatsHistogram();
+    m_txDepth = StatsHistogram();
+    m_uartToTcpMaxUs = 0;
+    m_tcpToUartMaxUs = 0;
+    m_uartToTcpUs = StatsHistogram();
+    m_tcpToUartUs = StatsHistogram();
+    m_trailerDropped = 0;
+    m_ticked = false;
+}
+
+void BridgeStats::request(int len, uint8_t* data)
+{
+    int size = record(m_record, sizeof(m_record));
+    if (size > 0) {
+        m_client.write(size, m_record);
+    }
+
+    if (len > 0 && (data[0] & BRIDGE_STATS_RESET)) {
+        reset();
+    }
+}
+
+void BridgeStats::clockSync(int len, uint8_t* data)
+{
+    if (len < 5) {
+        return;
+    }
+
+    const unsigned long rxUs = m_client.frameTimeUs();
+    unsigned int pos = 0;
+    const uint8_t flags = Convert::FB::readU8(data, &pos);
+    const uint32_t hostTime = Convert::FB::readU32(data, &pos);
+    m_trailer = (flags & BRIDGE_CLOCK_TRAILER) != 0;
+
+    uint8_t reply[14];
+    pos = 0;
+    Convert::FB::writeU8(reply, &pos, BRIDGE_CLOCK_CMD);
+    Convert::FB::writeU8(reply, &pos, flags);
+    Convert::FB::writeU32(reply, &pos, hostTime);
+    Convert::FB::writeU32(reply, &pos, rxUs);
+    Convert::FB::writeU32(reply, &pos, micros());
+    m_client.write(static_cast<int>(pos), reply);
+    m_client.flush(); // tx time must not wait for batch deadline
+}
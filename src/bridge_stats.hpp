@@ -0,0 +1,120 @@
+#ifndef BRIDGE_STATS_H
+#define BRIDGE_STATS_H
+
+#include "kuart.hpp"
+#include "TcpClient.hpp"
+
+/*
+ * Bridge counters and histograms, host asks for them over TCP with reserved command:
+ *
+ *  request : {BRIDGE_STATS_CMD}[{flags}]       flags BRIDGE_STATS_RESET -> counters are cleared after reply
+ *  reply   : {BRIDGE_STATS_CMD}{BRIDGE_STATS_VERSION}{record}, all fields big endian (Convert::FB)
+ *
+ *  record  : uptime ms                                                             u32
+ *            uart: bytes in, frames in, bytes out, frames out,
+ *                  crc errors, resyncs, oversize, fifo overflows, buffer full,
+ *                  rx high water                                                   10 x u32
+ *            tcp : bytes in, frames in, bytes out, frames out,
+ *                  crc errors, resyncs, oversize, connects, disconnects,
+ *                  tx dropped, tx pending, tx high water                           12 x u32
+ *            loop: iterations, max us                                              2 x u32
+ *            loop time histogram, us                                               BRIDGE_STATS_BINS x u32
+ *            tcp tx queue depth histogram, bytes                                   BRIDGE_STATS_BINS x u32
+ *            latency: uart->tcp max us, tcp->uart max us                           2 x u32
+ *            uart->tcp latency histogram, us                                       BRIDGE_STATS_BINS x u32
+ *            tcp->uart latency histogram, us                                       BRIDGE_STATS_BINS x u32
+ *            uart->tcp frames dropped, too long for trailer                        u32
+ *
+ * Histogram bin 0 counts zero values, bin i counts values in [2^(i-1), 2^i), last bin takes the rest.
+ *
+ * Latency: frames forwarded with toTcp() / toUart() are measured from decode completion
+ * (Kuart::frameTimeUs(), TcpClient::frameTimeUs()) until write() to other side returned.
+ * Time spent in TCP TX queue after that is in TcpClient::txStats().
+ *
+ * Clock sync and timestamp trailer, host can compute one-way latency in its own time:
+ *
+ *  request : {BRIDGE_CLOCK_CMD}{flags}{host time u32}     flags BRIDGE_CLOCK_TRAILER -> trailer on, else off
+ *  reply   : {BRIDGE_CLOCK_CMD}{flags}{host time u32}{device rx us u32}{device tx us u32}
+ *
+ *  host: offset = ((rx - t0) + (tx - t3)) / 2, t0/t3 = host send/receive time (NTP style),
+ *  with trailer on every toTcp() frame gets {decode time us u32} appended (device micros()),
+ *  so its payload may be BRIDGE_CLOCK_MAX_PAYLOAD bytes at most: longer frames are dropped
+ *  and counted (record), host always takes last 4 bytes as trailer.
+ */
+
+#define BRIDGE_STATS_CMD 0xF3
+#define BRIDGE_STATS_VERSION 3
+#define BRIDGE_STATS_RESET 0x01
+#define BRIDGE_STATS_BINS 16
+
+#define BRIDGE_STATS_RECORD_SIZE (2 + 4 * (1 + 10 + 12 + 2 + 2 * BRIDGE_STATS_BINS + 2 + 2 * BRIDGE_STATS_BINS + 1))
+
+#define BRIDGE_CLOCK_CMD 0xF4
+#define BRIDGE_CLOCK_TRAILER 0x01
+#define BRIDGE_CLOCK_TRAILER_SIZE 4
+#define BRIDGE_CLOCK_MAX_PAYLOAD (FRAME_CODEC_MAX_PAYLOAD - BRIDGE_CLOCK_TRAILER_SIZE)
+
+struct StatsHistogram
+{
+    uint32_t bins[BRIDGE_STATS_BINS] = {};
+
+    inline void add(uint32_t value)
+    {
+        unsigned int bin = value ? (32U - __builtin_clz(value)) : 0;
+        ++bins[bin < BRIDGE_STATS_BINS ? bin : (BRIDGE_STATS_BINS - 1)];
+    }
+};
+
+class BridgeStats
+{
+public:
+    BridgeStats(Kuart& kuart, TcpClient& client);
+
+    // registers BRIDGE_STATS_CMD and BRIDGE_CLOCK_CMD handlers on client
+    void attach();
+
+    // forward frame to other side and measure its latency, use as kuart / client handlers
+    void toTcp(int len, uint8_t* data);
+    void toUart(int len, uint8_t* data);
+    // frame decoded earlier (store-and-forward replay), decodedUs in micros() time
+    void toTcp(int len, uint8_t* data, unsigned long decodedUs);
+
+    inline void setTrailer(bool trailer) {m_trailer = trailer;}
+    inline bool hasTrailer() const {return m_trailer;}
+
+    // once per loop() iteration: loop time and queue depth samples
+    void loopTick();
+
+    // returns record size or -1 if buffer is too small
+    int record(uint8_t* out, unsigned int size) const;
+    void reset();
+
+    // BRIDGE_STATS_CMD handler, reply goes back through client
+    void request(int len, uint8_t* data);
+
+    // BRIDGE_CLOCK_CMD handler
+    void clockSync(int len, uint8_t* data);
+
+private:
+    Kuart& m_kuart;
+    TcpClient& m_client;
+
+    unsigned long m_lastTickUs = 0;
+    bool m_ticked = false;
+    uint32_t m_iterations = 0;
+    uint32_t m_loopMaxUs = 0;
+    StatsHistogram m_loopUs;
+    StatsHistogram m_txDepth;
+
+    uint32_t m_uartToTcpMaxUs = 0;
+    uint32_t m_tcpToUartMaxUs = 0;
+    StatsHistogram m_uartToTcpUs;
+    StatsHistogram m_tcpToUartUs;
+
+    bool m_trailer = false;
+    uint32_t m_trailerDropped = 0;  // frames longer than BRIDGE_CLOCK_MAX_PAYLOAD with trailer on
+    uint8_t m_frame[FRAME_CODEC_MAX_PAYLOAD];
+    uint8_t m_record[BRIDGE_STATS_RECORD_SIZE];
+};
+
+#endif /* BRIDGE_STATS_H */
@@ -7,96 +7,149 @@ Kuart::Kuart(int uart_nr) :
     
 }
 
-void Kuart::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin)
+uint32_t Kuart::rxBuffSizeFor(unsigned long baud, unsigned int rxStallMs)
 {
-    SerialPort.begin(baud, config, rxPin, txPin);
+    // 8N1 -> 10 bits per byte
+    uint64_t size = (static_cast<uint64_t>(baud) / 10U) * rxStallMs / 1000U;
+
+    if (size < K_UART_RX_BUFF_MIN) {
+        size = K_UART_RX_BUFF_MIN;
+    } else if (size > K_UART_RX_BUFF_MAX) {
+        size = K_UART_RX_BUFF_MAX;
+    }
+    return static_cast<uint32_t>(size);
 }
 
-void Kuart::write(int len, unsigned char *ptr)
+void Kuart::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin,
+                  int8_t rtsPin, int8_t ctsPin, unsigned int rxStallMs)
 {
-    uint8_t packLen = static_cast<uint8_t>(len >= m_startByte ? (len + 1) : len);
-    uint8_t crc = _proceedCrc(0xFF, packLen);
-
-    m_sendBuffer[0] = m_startByte;
-    m_sendBuffer[1] = packLen;
-
-    int pos = 2;
-    auto addByte = [&](uint8_t b) {
-        crc = _proceedCrc(crc, b);
-        m_sendBuffer[pos++] = b;
-        if (b == m_startByte) {
-            m_sendBuffer[pos++] = b;
-        }
-    };
+    m_baud = baud;
+    m_config = config;
+    m_rxPin = rxPin;
+    m_txPin = txPin;
+    m_rtsPin = rtsPin;
+    m_ctsPin = ctsPin;
+    m_rxStallMs = rxStallMs;
+    _open();
+}
 
-    for (uint8_t i = 0; i < len; i++) {
-        addByte(ptr[i]);
+void Kuart::setBaud(unsigned long baud)
+{
+    if (baud == m_baud) {
+        return;
+    }
+
+    // frames written before (baud switch ACK) must go out at old baud
+    SerialPort.flush();
+    const bool sameDriver = rxBuffSizeFor(baud, m_rxStallMs) == m_rxCounters.rxBuffSize
+                            && (baud > K_UART_HIGH_BAUD) == (m_baud > K_UART_HIGH_BAUD);
+    m_baud = baud;
+
+    if (sameDriver) {
+        SerialPort.updateBaudRate(baud);
+    } else {
+        // driver buffer can be resized only while driver is not installed
+        SerialPort.end();
+        _open();
     }
-    addByte(crc);
 
-    SerialPort.write(m_sendBuffer, pos);
+    // partial frame was at old baud
+    m_decoder.reset();
 }
 
-void Kuart::on(std::function<void(int len, uint8_t*)> foo)
+void Kuart::_open()
 {
-    m_handler = foo;
+    // driver buffer must be resized before begin()
+    m_rxCounters.rxBuffSize = SerialPort.setRxBufferSize(rxBuffSizeFor(m_baud, m_rxStallMs));
+    SerialPort.begin(m_baud, m_config, m_rxPin, m_txPin, false, 20000UL,
+                     m_baud > K_UART_HIGH_BAUD ? K_UART_RX_FIFO_FULL_HIGH : K_UART_RX_FIFO_FULL);
+
+    if (flowControl()) {
+        SerialPort.setPins(m_rxPin, m_txPin, m_ctsPin, m_rtsPin);
+        SerialPort.setHwFlowCtrlMode(UART_HW_FLOWCTRL_CTS_RTS, K_UART_RTS_THRESHOLD);
+    }
+
+    // end() drops handlers, they are set on every open
+    SerialPort.onReceiveError([this](hardwareSerial_error_t err) {
+        if (err == UART_FIFO_OVF_ERROR) {
+            m_rxCounters.fifoOverflows = m_rxCounters.fifoOverflows + 1;
+        } else if (err == UART_BUFFER_FULL_ERROR) {
+            m_rxCounters.bufferFull = m_rxCounters.bufferFull + 1;
+        }
+    });
 }
 
-void Kuart::proceed()
+void Kuart::write(int len, unsigned char *ptr)
 {
-    int len = SerialPort.read(m_tmp, 10);
-
-    for (int  i = 0; i < len; ++i) {
-        auto ch = m_tmp[i];
-
-        if (m_triggerSB) {
-            if(ch == m_startByte) { //{SB}{SB} -> {SB}
-                _proceedByte(ch, false);
-            } else { //{SB}{!SB} -> {SB} and newframe
-                _proceedByte(ch, true);
-            }
-            m_triggerSB = false;
-        } else if (ch == m_startByte) { //{!SB}{SB} -> set flag and skip step
-            m_triggerSB = true;
-        } else { //{!SB}{!SB} -> {!SB}
-            _proceedByte(ch, false);
-        }
+    int size = FrameEncoder::encode(len, ptr, m_txChunk, K_UART_TX_CHUNK, [this](const uint8_t* data, int n) {
+        SerialPort.write(data, n);
+    });
+
+    if (size > 0) {
+        ++m_stats.framesOut;
+        m_stats.bytesOut += len;
     }
 }
 
+void Kuart::writeRaw(int len, const unsigned char* ptr)
+{
+    m_stats.bytesOut += SerialPort.write(ptr, len);
+}
+
+void Kuart::resetStats()
+{
+    m_stats = KuartStats();
+    m_decoder.resetStats();
+}
 
-void Kuart::_proceedByte(uint8_t ch, bool newFrame)
+void Kuart::on(std::function<void(int len, uint8_t*)> foo)
 {
-    //Serial.print("PROCEED BYTE: "); Serial.print(ch); Serial.print("  ");Serial.print(newFrame); Serial.println("");
-    if (newFrame) {
-        m_frameCrc = 0xFF;
-        m_receivePos = 0;
+    if (!foo) {
+        m_decoder.on(nullptr);
+        return;
     }
 
-    if (m_receivePos == 0) {
-        m_receivePackLen = ch;
+    m_decoder.on([this, foo](int len, uint8_t* data) {
+        m_frameTimeUs = micros();
+        foo(len, data);
+    });
+}
 
-        if (m_receivePackLen > m_startByte) {
-            m_receivePackLen -= 1;
-        }
-    } else if ((m_receivePos - 1) < m_receivePackLen) {
-        m_recBuffer[m_receivePos-1] = ch;
-    } else if ((m_receivePos - 1) == m_receivePackLen && m_frameCrc == ch) {
-        if(m_handler) {
-            m_handler(m_receivePackLen, m_recBuffer);
-        }
-    } else {
+void Kuart::setRaw(bool raw)
+{
+    m_raw = raw;
+    m_decoder.reset();
+}
+
+void Kuart::onRaw(std::function<void(int len, uint8_t*)> foo)
+{
+    m_rawHandler = foo;
+}
+
+void Kuart::proceed()
+{
+    // drain everything that is waiting now, new bytes are left for next call
+    int avail = SerialPort.available();
+    if (avail <= 0) {
         return;
     }
 
-    m_receivePos++;
-    m_frameCrc =  _proceedCrc(m_frameCrc, ch);
-}
+    if (static_cast<uint32_t>(avail) > m_rxCounters.highWater) {
+        m_rxCounters.highWater = avail;
+    }
 
+    while (avail > 0) {
+        int len = SerialPort.read(m_rxChunk, avail < K_UART_RX_CHUNK ? avail : K_UART_RX_CHUNK);
+        if (len <= 0) {
+            break;
+        }
+        m_stats.bytesIn += len;
 
-uint8_t Kuart::_proceedCrc(uint8_t crc, uint8_t ch) {
-    crc ^= ch;
-    for (int i = 0; i < 8; i++)
-        crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
-    return crc;
-}
\ No newline at end of file
+        if (!m_raw) {
+            m_decoder.proceed(m_rxChunk, len);
+        } else if (m_rawHandler) {
+            m_rawHandler(len, m_rxChunk);
+        }
+        avail -= len;
+    }
+}
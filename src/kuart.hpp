@@ -3,43 +3,105 @@
 
 #include <map>
 #include <HardwareSerial.h>
+#include "frame_codec.h"
+
+#define K_UART_TX_CHUNK 128         // encoded bytes per driver write, any frame size goes through it
+
+// RX path: driver ring buffer must hold (baud / 10) bytes/sec for worst case loop stall
+#ifndef K_UART_RX_STALL_MS
+#   define K_UART_RX_STALL_MS 50U
+#endif /* K_UART_RX_STALL_MS */
+
+#define K_UART_RX_BUFF_MIN 256U     // must be bigger than hardware FIFO (128 bytes)
+#define K_UART_RX_BUFF_MAX 32768U
+#define K_UART_RX_CHUNK 256         // bytes per driver read
+
+// high baud (2-5 Mbaud): 128 bytes FIFO lasts ~250 us at 5 Mbaud, RX interrupt comes earlier
+// and RTS stops peer before FIFO is full when flow control pins are given
+#define K_UART_HIGH_BAUD 1000000UL
+#define K_UART_RX_FIFO_FULL 112     // driver default
+#define K_UART_RX_FIFO_FULL_HIGH 64
+#ifndef K_UART_RTS_THRESHOLD
+#   define K_UART_RTS_THRESHOLD 96  // FIFO bytes, RTS goes inactive above it
+#endif /* K_UART_RTS_THRESHOLD */
+
+/*
+ * Raw mode: no framing and no CRC, bytes read from driver go to onRaw() handler as they
+ * are (straight from read buffer) and writeRaw() passes bytes to driver unchanged.
+ */
+
+struct KuartRxCounters
+{
+    volatile uint32_t fifoOverflows = 0;   // hardware FIFO overflowed before driver emptied it
+    volatile uint32_t bufferFull = 0;      // driver ring buffer was full, bytes dropped
+    uint32_t highWater = 0;                // max bytes waiting in driver ring buffer
+    uint32_t rxBuffSize = 0;               // configured driver ring buffer size
+};
 
-#define K_UART_BUFF_SIZE 256
+struct KuartStats
+{
+    uint32_t bytesIn = 0;       // bytes read from driver (framed and raw)
+    uint32_t framesOut = 0;
+    uint32_t bytesOut = 0;      // payload bytes of written frames, raw bytes as they are
+};
 
 class Kuart
 {
 public:
     Kuart(int uart_nr);
 
-    void begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin);
+    // rtsPin/ctsPin >= 0 -> hardware flow control (both must be given)
+    void begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin,
+               int8_t rtsPin = -1, int8_t ctsPin = -1, unsigned int rxStallMs = K_UART_RX_STALL_MS);
+    // waits until TX is done, then reopens driver at new baud (RX buffer is resized for it),
+    // bytes received but not read yet are dropped
+    void setBaud(unsigned long baud);
+    inline unsigned long baud() const {return m_baud;}
+    inline bool flowControl() const {return m_rtsPin >= 0 && m_ctsPin >= 0;}
     void write(int len, unsigned char*);
 
     void on(std::function<void(int len, uint8_t*)>);
     void proceed();
 
-private:
-
-    void _proceedByte(uint8_t byte, bool newFrame);
-    uint8_t _proceedCrc(uint8_t crc, uint8_t ch);
-
-    HardwareSerial SerialPort;
-    std::function<void(int len, uint8_t*)> m_handler = nullptr;
-    int m_packLen = -1;
+    // micros() when frame now given to on() handler was decoded
+    inline unsigned long frameTimeUs() const {return m_frameTimeUs;}
 
+    // raw mode --------------------------------
+    void setRaw(bool raw);
+    inline bool isRaw() const {return m_raw;}
+    void onRaw(std::function<void(int len, uint8_t*)>);
+    void writeRaw(int len, const unsigned char* ptr);
 
-    const uint8_t m_startByte = 0x1A;
-    uint8_t m_recBuffer[K_UART_BUFF_SIZE];
-    uint8_t m_sendBuffer[K_UART_BUFF_SIZE];
+    inline const KuartRxCounters& rxCounters() const {return m_rxCounters;}
+    inline const KuartStats& stats() const {return m_stats;}
+    inline const FrameDecoderStats& decoderStats() const {return m_decoder.stats();}
+    void resetStats();
+    static uint32_t rxBuffSizeFor(unsigned long baud, unsigned int rxStallMs);
 
-    uint8_t m_tmp[10];
+private:
+    void _open();
 
-    bool m_triggerSB = false;
-    uint8_t m_frameCrc = 0xFF;
-    uint8_t m_receivePos = 0;
-    uint16_t m_receivePackLen = 0;
+    HardwareSerial SerialPort;
+    unsigned long m_baud = 0;
+    uint32_t m_config = 0;
+    int8_t m_rxPin = -1;
+    int8_t m_txPin = -1;
+    int8_t m_rtsPin = -1;
+    int8_t m_ctsPin = -1;
+    unsigned int m_rxStallMs = K_UART_RX_STALL_MS;
+    FrameDecoder m_decoder;
+    KuartRxCounters m_rxCounters;
+    KuartStats m_stats;
+    unsigned long m_frameTimeUs = 0;
+
+    bool m_raw = false;
+    std::function<void(int len, uint8_t*)> m_rawHandler = nullptr;
+
+    uint8_t m_txChunk[K_UART_TX_CHUNK];
+    uint8_t m_rxChunk[K_UART_RX_CHUNK];
 };
 
 
 
 
-#endif /* K_UART */
\ No newline at end of file
+#endif /* K_UART */
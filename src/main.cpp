@@ -3,7 +3,19 @@
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include "TcpClient.hpp"
+#include "TcpServer.hpp"
+#include "UdpTransport.hpp"
+#include "reliable_link.h"
+#include "WsTransport.hpp"
+#include "flow_control.h"
 #include "kuart.hpp"
+#include "bridge.hpp"
+#include "bridge_stats.hpp"
+#include "uart_mux.hpp"
+#include "store_forward.h"
+#include "FlashLog.hpp"
+#include "WifiLink.hpp"
+#include "baud_switch.h"
 
 #include "imu_worker.h"
 #include "convert.h"
@@ -21,21 +33,78 @@ const uint16_t port = 8092;
 const char *host = "192.168.71.113";
 TcpClient client;
 
+// server mode: build with -D BRIDGE_SERVER, host tools connect to ESP32 on same port
+#ifdef BRIDGE_SERVER
+TcpServer server(port);
+#endif /* BRIDGE_SERVER */
+
+// websocket: build with -D BRIDGE_WS, browser dashboards connect to ws://<esp ip>:BRIDGE_WS_PORT/ws
+#ifdef BRIDGE_WS
+#   define BRIDGE_WS_PORT 80
+WsTransport ws(BRIDGE_WS_PORT);
+#endif /* BRIDGE_WS */
+
+// flow control: build with -D BRIDGE_FLOW, host and uart peer exchange credit frames (default mode only)
+#ifdef BRIDGE_FLOW
+// frames each source may send ahead, queue holds all of them (bigger window: -D FLOW_CONTROL_QUEUE_SIZE)
+#   define BRIDGE_FLOW_WINDOW FLOW_CONTROL_MAX_WINDOW
+static_assert(BRIDGE_FLOW_WINDOW >= 1 && BRIDGE_FLOW_WINDOW <= FLOW_CONTROL_MAX_WINDOW, "BRIDGE_FLOW_WINDOW does not fit FLOW_CONTROL_QUEUE_SIZE");
+uint32_t flowClock() { return millis(); }
+FlowControl uplink(flowClock);      // uart -> tcp
+FlowControl downlink(flowClock);    // tcp -> uart
+unsigned int flowReportTime = 0;
+#endif /* BRIDGE_FLOW */
+
+// store-and-forward: build with -D BRIDGE_STORE, uart frames wait in RAM and flash log while
+// tcp link is down and are replayed in order after reconnect (default mode only)
+#ifdef BRIDGE_STORE
+#   if defined(BRIDGE_RAW) || defined(BRIDGE_FLOW) || defined(BRIDGE_MUX) || defined(BRIDGE_TASKS) \
+       || defined(BRIDGE_SERVER) || defined(BRIDGE_WS) || defined(BRIDGE_UDP)
+#       error "BRIDGE_STORE works only in default client mode"
+#   endif
+#   define BRIDGE_STORE_RETENTION_MS 600000U   // older frames are not worth replaying
+#   define BRIDGE_STORE_REPLAY_RATE 0U          // bytes/sec, 0 -> link speed
+uint32_t storeClock() { return millis(); }
+StoreForward store(storeClock);
+FlashLog storeLog;
+#endif /* BRIDGE_STORE */
+
+// udp mode: build with -D BRIDGE_UDP, frames go in datagrams to host:port (telemetry, loss is allowed)
+// host commands for uart may go as reliable frames (ACK + retransmit), telemetry stays unreliable
+#ifdef BRIDGE_UDP
+UdpTransport udp(port);
+ReliableLink reliable([]() -> uint32_t { return millis(); });
+#endif /* BRIDGE_UDP */
+
+// fast start: cached BSSID/channel, static IP with -D BRIDGE_STATIC_IP (no DHCP)
+WifiLink wifi;
+bool fastStartReported = false;
+
 void connectToWifi()
 {
-  WiFi.begin(ssid, password);
+#ifdef BRIDGE_STATIC_IP
+  wifi.setStaticIp(IPAddress(192, 168, 71, 50), IPAddress(192, 168, 71, 1), IPAddress(255, 255, 255, 0));
+#endif /* BRIDGE_STATIC_IP */
+#ifndef BRIDGE_TASKS
+  // socket of lost Wi-Fi is dead, do not wait for TCP timeout (TCP task finds it by itself)
+  wifi.onChange([](bool up) {
+    if (!up) {
+      client.disconnect();
+    }
+  });
+#endif /* BRIDGE_TASKS */
+  wifi.begin(ssid, password);
   Serial.println(String("Try connect to ") + ssid);
 
-  while (true) {
-    if (WiFi.status() == WL_CONNECTED) {
-      break;
-    }
-    delay(500);
-    Serial.println("...");
+  // client modes connect from loop(), servers need network before begin()
+#if defined(BRIDGE_SERVER) || defined(BRIDGE_WS) || defined(BRIDGE_UDP)
+  while (!wifi.proceed(millis())) {
+    delay(10);
   }
 
   Serial.print("WiFi connected with IP: ");
   Serial.println(WiFi.localIP());
+#endif
 }
 
 // LED pins-----------------------------------------------------------
@@ -44,25 +113,316 @@ const int led1 = 2;
 // translation uart -------------------------------------------------
 Kuart kuart(2); // use UART2
 
+// hardware flow control for high baud: -D BRIDGE_UART_RTS=<pin> -D BRIDGE_UART_CTS=<pin>
+#ifndef BRIDGE_UART_RTS
+#   define BRIDGE_UART_RTS -1
+#endif /* BRIDGE_UART_RTS */
+#ifndef BRIDGE_UART_CTS
+#   define BRIDGE_UART_CTS -1
+#endif /* BRIDGE_UART_CTS */
+#define BRIDGE_UART_BAUD 115200UL       // start baud, uart peer may switch it with BAUD_SWITCH_CMD
+
+// throughput test: build with -D BRIDGE_BAUD_TEST, wire UART2 TX to RX (and RTS to CTS), result
+// for every baud goes to debug uart at start, then bridge works as usual
+#ifdef BRIDGE_BAUD_TEST
+#   define BRIDGE_BAUD_TEST_MS 1000U
+#   define BRIDGE_BAUD_TEST_FRAME 256
+const unsigned long baudTestRates[] = {115200, 921600, 2000000, 3000000, 4000000, 5000000};
+#endif /* BRIDGE_BAUD_TEST */
+
+// multi uart: build with -D BRIDGE_MUX, UART2 (channel 0) and UART1 (channel 1) share one connection
+#ifdef BRIDGE_MUX
+#   define BRIDGE_MUX_RX1 25
+#   define BRIDGE_MUX_TX1 26
+Kuart kuart1(1);
+UartMux mux;
+bool muxLinkUp = false;             // client status of this loop() pass
+#endif /* BRIDGE_MUX */
+
+// bridge mode: build with -D BRIDGE_TASKS to run UART and TCP in own tasks on both cores
+// raw mode: build with -D BRIDGE_RAW to pass bytes without framing (device speaks own protocol)
+#ifdef BRIDGE_RAW
+#   define BRIDGE_RAW_MODE true
+#else
+#   define BRIDGE_RAW_MODE false
+#endif /* BRIDGE_RAW */
+
+#ifdef BRIDGE_TASKS
+Bridge bridge(kuart, client);
+unsigned int bridgeReportTime = 0;
+#endif /* BRIDGE_TASKS */
+
+// client modes driven from loop(): host reads counters with BRIDGE_STATS_CMD frame
+#if !defined(BRIDGE_TASKS) && !defined(BRIDGE_SERVER) && !defined(BRIDGE_WS) && !defined(BRIDGE_UDP)
+#   define BRIDGE_STATS
+BridgeStats stats(kuart, client);
+#endif
+
+// default mode: host (over tcp) or uart peer may change uart baud at runtime, it goes back to
+// old baud if new one does not work (uart peer runs same BaudSwitch), side that gives up sends
+// REVERT so peer follows. Idle watchdog back to BRIDGE_UART_BAUD: -D BRIDGE_BAUD_WATCHDOG_MS=<ms>,
+// only if uart peer runs it with same time (one sided watchdog breaks quiet link by itself)
+#if defined(BRIDGE_STATS) && !defined(BRIDGE_RAW) && !defined(BRIDGE_FLOW) && !defined(BRIDGE_MUX)
+#   define BRIDGE_BAUD_SWITCH
+uint32_t baudClock() { return millis(); }
+BaudSwitch baudSwitch(baudClock);
+
+// reply to host: {BAUD_SWITCH_CMD}{result}{baud >> 24}..{baud}
+void baudSwitchReply(BaudSwitchResult result, uint32_t baud)
+{
+  uint8_t reply[6];
+  unsigned int pos = 0;
+  Convert::FB::writeU8(reply, &pos, BAUD_SWITCH_CMD);
+  Convert::FB::writeU8(reply, &pos, static_cast<uint8_t>(result));
+  Convert::FB::writeU32(reply, &pos, baud);
+  client.write(pos, reply);
+}
+#endif
+
+#ifdef BRIDGE_BAUD_TEST
+void runBaudTest()
+{
+  uint8_t frame[BRIDGE_BAUD_TEST_FRAME];
+  for (int i = 0; i < BRIDGE_BAUD_TEST_FRAME; ++i) {
+    frame[i] = static_cast<uint8_t>(i);
+  }
+
+  uint32_t received = 0;
+  kuart.on([&received](int len, uint8_t *) {
+    received += len;
+  });
+
+  for (unsigned long baud : baudTestRates) {
+    kuart.setBaud(baud);
+    kuart.proceed();
+    kuart.resetStats();
+    const uint32_t fifoOverflows = kuart.rxCounters().fifoOverflows;
+    const uint32_t bufferFull = kuart.rxCounters().bufferFull;
+    received = 0;
+
+    // driver write blocks while tx buffer is full, so sending goes at line speed
+    uint32_t sent = 0;
+    const uint32_t start = millis();
+    while ((millis() - start) < BRIDGE_BAUD_TEST_MS) {
+      kuart.write(sizeof(frame), frame);
+      sent += sizeof(frame);
+      kuart.proceed();
+    }
+    delay(20);
+    kuart.proceed();
+
+    // payload bytes against line capacity (10 bits per byte)
+    const uint32_t line = static_cast<uint32_t>(static_cast<uint64_t>(baud) * BRIDGE_BAUD_TEST_MS / 10000U);
+    char string[192];
+    snprintf(string, sizeof(string), "baud %lu%s: sent %u received %u B (%u kB/s, %u%% of line) crc %u fifo ovf %u buffer full %u",
+             baud, kuart.flowControl() ? " rts/cts" : "", (unsigned)sent, (unsigned)received,
+             (unsigned)(received / BRIDGE_BAUD_TEST_MS), (unsigned)(static_cast<uint64_t>(received) * 100U / line),
+             (unsigned)kuart.decoderStats().crcErrors, (unsigned)(kuart.rxCounters().fifoOverflows - fifoOverflows),
+             (unsigned)(kuart.rxCounters().bufferFull - bufferFull));
+    Serial.println(string);
+  }
+
+  kuart.on(nullptr);
+  kuart.setBaud(BRIDGE_UART_BAUD);
+  kuart.resetStats();
+}
+#endif /* BRIDGE_BAUD_TEST */
+
 void setup()
 {
   // init debug uart
   Serial.begin(115200);
-  kuart.begin(115200, SERIAL_8N1, 16, 17);
+  kuart.begin(BRIDGE_UART_BAUD, SERIAL_8N1, 16, 17, BRIDGE_UART_RTS, BRIDGE_UART_CTS);
   pinMode(led1, OUTPUT);
+#ifdef BRIDGE_BAUD_TEST
+  runBaudTest();
+#endif /* BRIDGE_BAUD_TEST */
 
   // init Wi-fi
   Serial.println("!!!!!!!!!!!WAKE UP!!!!!!!!!");
   connectToWifi();
+  client.setTxBatching(TCP_CLIENT_BATCH_SIZE, TCP_CLIENT_BATCH_DEADLINE_US);
+#ifdef BRIDGE_TASKS
   client.on(1, [](int len, uint8_t *data) {
+    bridge.toUart(len, data);
+  });
+
+  // command uart is connected to client inside bridge
+  bridge.setDropPolicy(BRIDGE_DROP_OLDEST);
+  if (!bridge.begin(port, host, BRIDGE_RAW_MODE)) {
+    Serial.println("Bridge tasks start failed");
+  }
+#elif defined(BRIDGE_SERVER)
+  server.begin();
+  server.on(1, [](int len, uint8_t *data) {
     kuart.write(len, data);
-    //client.write(len, data);
   });
 
-  // command uart
+  // every uart frame goes to all connected clients
+  kuart.on([](int len, uint8_t *data) {
+    server.write(len, data);
+  });
+#elif defined(BRIDGE_WS)
+  ws.begin();
+  ws.on(1, [](int len, uint8_t *data) {
+    kuart.write(len, data);
+  });
+
+  kuart.on([](int len, uint8_t *data) {
+    ws.write(len, data);
+  });
+#elif defined(BRIDGE_UDP)
+  udp.setRemote(host, port);
+  udp.setSequence(true);
+  udp.begin();
+  udp.on(1, [](int len, uint8_t *data) {
+    kuart.write(len, data);
+  });
+
+  // new epoch per boot, peer receiver drops state of previous session (esp_random() based)
+  reliable.reset(static_cast<uint8_t>(random(256)));
+  // reliable frames go out at once, not after datagram deadline
+  reliable.output([](int len, uint8_t *data) {
+    udp.write(len, data);
+    udp.flush();
+  });
+  reliable.on([](int len, uint8_t *data) {
+    kuart.write(len, data);
+  });
+  udp.on(RELIABLE_LINK_CMD_DATA, CommandHandler::bind<ReliableLink, &ReliableLink::dataFrame>(&reliable));
+  udp.on(RELIABLE_LINK_CMD_ACK, CommandHandler::bind<ReliableLink, &ReliableLink::ackFrame>(&reliable));
+
+  kuart.on([](int len, uint8_t *data) {
+    udp.write(len, data);
+  });
+#elif defined(BRIDGE_RAW)
+  client.setRaw(true);
+  client.onRaw([](int len, uint8_t *data) {
+    kuart.writeRaw(len, data);
+  });
+
+  kuart.setRaw(true);
+  kuart.onRaw([](int len, uint8_t *data) {
+    client.writeRaw(len, data);
+  });
+#elif defined(BRIDGE_FLOW)
+  // uart -> tcp: telemetry, old frames are worth less than new ones
+  uplink.output([](int len, uint8_t *data) {
+    client.write(len, data);
+  });
+  uplink.upstream([](int len, uint8_t *data) {
+    kuart.write(len, data);
+  }, BRIDGE_FLOW_WINDOW);
+  uplink.setPolicy(FLOW_DROP_OLDEST);
+  client.on(FLOW_CONTROL_CMD_CREDIT, CommandHandler::bind<FlowControl, &FlowControl::creditFrame>(&uplink));
+
+  // tcp -> uart: commands, wait for uart peer credit (uart is read while waiting)
+  downlink.output([](int len, uint8_t *data) {
+    kuart.write(len, data);
+  });
+  downlink.upstream([](int len, uint8_t *data) {
+    client.write(len, data);
+  }, BRIDGE_FLOW_WINDOW);
+  downlink.setPolicy(FLOW_BLOCK);
+  downlink.setBlockPoll([]() {
+    kuart.proceed();
+  });
+  client.on(1, [](int len, uint8_t *data) {
+    downlink.write(len, data);
+  });
+
   kuart.on([](int len, uint8_t *data) {
+    if (!downlink.input(len, data)) {
+      uplink.write(len, data);
+    }
+  });
+  uplink.advertise();
+#elif defined(BRIDGE_MUX)
+  kuart1.begin(115200, SERIAL_8N1, BRIDGE_MUX_RX1, BRIDGE_MUX_TX1);
+  mux.add(kuart);
+  mux.add(kuart1);
+  mux.setScheduler(UART_MUX_ROUND_ROBIN);
+
+  // all channels go through one client tx queue and its batching
+  mux.output([](int len, uint8_t *data) {
     client.write(len, data);
   });
+  // frames wait in channel queues (and keep scheduler fairness) instead of being dropped by client
+  mux.ready([](int len) {
+    return muxLinkUp && client.txFree() >= static_cast<uint32_t>(FRAME_CODEC_ENCODED_SIZE(len));
+  });
+  client.on(UART_MUX_CMD, CommandHandler::bind<UartMux, &UartMux::input>(&mux));
+#else
+  // both directions go through stats: latency histograms and optional timestamp trailer
+  client.on(1, CommandHandler::bind<BridgeStats, &BridgeStats::toUart>(&stats));
+
+#   ifdef BRIDGE_STORE
+  if (storeLog.begin()) {
+    store.setLog(&storeLog);
+  } else {
+    Serial.println("Store log is not available, RAM only");
+  }
+  store.setPolicy(STORE_DROP_OLDEST);
+  store.setRetention(BRIDGE_STORE_RETENTION_MS);
+  store.setReplayRate(BRIDGE_STORE_REPLAY_RATE);
+
+  // replay only as fast as client tx queue takes frames, nothing is dropped there
+  // (room for timestamp trailer too)
+  store.ready([](int len) {
+    return client.txFree() >= static_cast<uint32_t>(FRAME_CODEC_ENCODED_SIZE(len + BRIDGE_CLOCK_TRAILER_SIZE));
+  });
+  // through stats: counters, latency (stored frames count time in store) and trailer
+  store.output([](int len, uint8_t *data) {
+    if (store.frameStored()) {
+      const uint32_t ageMs = millis() - store.frameTime();
+      stats.toTcp(len, data, micros() - ageMs * 1000UL);
+    } else {
+      stats.toTcp(len, data);
+    }
+  });
+
+  kuart.on([](int len, uint8_t *data) {
+    if (!baudSwitch.input(len, data)) {
+      store.write(len, data);
+    }
+  });
+#   else
+  // command uart
+  kuart.on([](int len, uint8_t *data) {
+    if (!baudSwitch.input(len, data)) {
+      stats.toTcp(len, data);
+    }
+  });
+#   endif /* BRIDGE_STORE */
+
+  // host asks {BAUD_SWITCH_CMD}{baud >> 24}..{baud}, result comes back when uart peer answered
+  baudSwitch.output([](int len, uint8_t *data) {
+    kuart.write(len, data);
+  });
+  baudSwitch.onBaud([](uint32_t baud) {
+    kuart.setBaud(baud);
+  });
+  baudSwitch.onResult(baudSwitchReply);
+  baudSwitch.begin(kuart.baud());
+#   ifdef BRIDGE_BAUD_WATCHDOG_MS
+  baudSwitch.setWatchdog(BRIDGE_BAUD_WATCHDOG_MS);
+#   endif /* BRIDGE_BAUD_WATCHDOG_MS */
+  client.on(BAUD_SWITCH_CMD, [](int len, uint8_t *data) {
+    if (len < 4) {
+      return;
+    }
+    unsigned int pos = 0;
+    const uint32_t baud = Convert::FB::readU32(data, &pos);
+    const BaudSwitchResult result = baudSwitch.request(baud);
+    if (result != BAUD_SWITCH_OK) {
+      baudSwitchReply(result, baudSwitch.baud());
+    }
+  });
+#endif /* BRIDGE_TASKS */
+
+#ifdef BRIDGE_STATS
+  stats.attach();
+#endif /* BRIDGE_STATS */
 
   // get cpu frequancy
   char string[16];
@@ -71,10 +431,113 @@ void setup()
 }
 
 // client values -------------------
+#ifdef BRIDGE_TASKS
+void printQueueStats(const char *name, const BridgeQueueStats &stats)
+{
+  char string[96];
+  snprintf(string, sizeof(string), "%s: frames %u dropped %u high water %u/%u",
+           name, (unsigned)stats.frames, (unsigned)stats.dropped, (unsigned)stats.highWater, (unsigned)stats.size);
+  Serial.println(string);
+}
+
+void printBatchStats(const TcpBatchStats &stats)
+{
+  char string[192];
+  snprintf(string, sizeof(string), "tcp batch: flushes %u (size %u, deadline %u, call %u) frames %u bytes %u max %u B/%u frames hold %u us",
+           (unsigned)stats.flushes, (unsigned)stats.bySize, (unsigned)stats.byDeadline, (unsigned)stats.byCall,
+           (unsigned)stats.frames, (unsigned)stats.bytes, (unsigned)stats.maxBytes, (unsigned)stats.maxFrames, (unsigned)stats.maxHoldUs);
+  Serial.println(string);
+}
+
+void printTxStats(const TcpTxQueueStats &stats)
+{
+  char string[192];
+  snprintf(string, sizeof(string), "tcp tx: depth %u pending %u/%u high water %u dropped %u partial %u errors %u time in queue avg %u max %u us",
+           (unsigned)stats.depth, (unsigned)stats.pending, (unsigned)stats.size, (unsigned)stats.highWater, (unsigned)stats.dropped,
+           (unsigned)stats.partialWrites, (unsigned)stats.sendErrors, (unsigned)stats.avgTimeUs, (unsigned)stats.maxTimeUs);
+  Serial.println(string);
+}
+#endif /* BRIDGE_TASKS */
+
+#ifdef BRIDGE_FLOW
+void printFlowStats(const char *name, const FlowControlStats &stats)
+{
+  char string[160];
+  snprintf(string, sizeof(string), "%s: sent %u queued %u drop new %u old %u block timeouts %u (%u ms) credits %d high water %u",
+           name, (unsigned)stats.sent, (unsigned)stats.queued, (unsigned)stats.droppedNewest, (unsigned)stats.droppedOldest,
+           (unsigned)stats.blockTimeouts, (unsigned)stats.blockedMs, (int)stats.credits, (unsigned)stats.queueHighWater);
+  Serial.println(string);
+}
+#endif /* BRIDGE_FLOW */
+
+#if !defined(BRIDGE_SERVER) && !defined(BRIDGE_WS) && !defined(BRIDGE_UDP)
+// time from power-on to wifi, tcp and first frame taken by socket, once
+void printFastStart()
+{
+  if (fastStartReported || !client.stats().firstFrameMs) {
+    return;
+  }
+  fastStartReported = true;
+
+  char string[128];
+  snprintf(string, sizeof(string), "fast start: wifi %u ms (%s) tcp %u ms first frame %u ms",
+           (unsigned)wifi.stats().firstConnectMs, wifi.stats().fastConnects ? "cached" : "scan",
+           (unsigned)client.stats().firstConnectMs, (unsigned)client.stats().firstFrameMs);
+  Serial.println(string);
+}
+#endif
+
 void loop()
 {
   bool led_status = false;
-  int status = client.clientAutoProceedNonBlock(millis(), port, host);
+  wifi.proceed(millis());
+#ifdef BRIDGE_TASKS
+  // all work is done by bridge tasks, loop only shows state
+  int status = bridge.clientStatus();
+  if ((millis() - bridgeReportTime) > 5000U) {
+    bridgeReportTime = millis();
+    printQueueStats("uart->tcp", bridge.uartToTcpStats());
+    printQueueStats("tcp->uart", bridge.tcpToUartStats());
+    printBatchStats(client.batchStats());
+    printTxStats(client.txStats());
+  }
+  delay(10);
+#elif defined(BRIDGE_SERVER)
+  server.proceed();
+  int status = server.clientCount() ? CLIENT_OK : CLIENT_TRY_CONNECT;
+#elif defined(BRIDGE_WS)
+  ws.proceed();
+  int status = ws.clientCount() ? CLIENT_OK : CLIENT_TRY_CONNECT;
+#elif defined(BRIDGE_UDP)
+  udp.proceed();
+  reliable.poll();
+  int status = CLIENT_OK;
+#else
+  int status = wifi.connected() ? client.clientAutoProceedNonBlock(millis(), port, host) : CLIENT_TRY_CONNECT;
+#   ifdef BRIDGE_FLOW
+  if (status == CLIENT_CONNECTED) {
+    // new host: unlimited until it sends credit, tell it our window
+    uplink.resetPeer();
+    downlink.advertise();
+  }
+  uplink.proceed();
+  downlink.proceed();
+
+  if ((millis() - flowReportTime) > 5000U) {
+    flowReportTime = millis();
+    printFlowStats("uart->tcp", uplink.stats());
+    printFlowStats("tcp->uart", downlink.stats());
+  }
+#   endif /* BRIDGE_FLOW */
+#   ifdef BRIDGE_MUX
+  muxLinkUp = status == CLIENT_OK || status == CLIENT_CONNECTED;
+  mux.proceed();
+#   endif /* BRIDGE_MUX */
+#   ifdef BRIDGE_STORE
+  store.setLink(status == CLIENT_OK || status == CLIENT_CONNECTED);
+  store.proceed();
+#   endif /* BRIDGE_STORE */
+#endif /* BRIDGE_TASKS */
   if (status == CLIENT_TRY_CONNECT) {
     led_status = !led_status;
   } else if (status == CLIENT_OK) {
@@ -82,5 +545,19 @@ void loop()
   }
   digitalWrite(led1, led_status ? HIGH : LOW);
 
-  kuart.proceed();
+#if !defined(BRIDGE_TASKS) && !defined(BRIDGE_MUX)
+  kuart.proceed();  // mux.proceed() services its uarts
+#endif
+
+#ifdef BRIDGE_BAUD_SWITCH
+  baudSwitch.proceed();
+#endif /* BRIDGE_BAUD_SWITCH */
+
+#ifdef BRIDGE_STATS
+  stats.loopTick();
+#endif /* BRIDGE_STATS */
+
+#if !defined(BRIDGE_SERVER) && !defined(BRIDGE_WS) && !defined(BRIDGE_UDP)
+  printFastStart();
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "uart_mux.hpp"
+#include <limits.h>
+
+
+UartMux::UartMux()
+{
+
+}
+
+int UartMux::add(Kuart& kuart, uint8_t weight)
+{
+    if (m_count >= UART_MUX_MAX_CHANNELS) {
+        return -1;
+    }
+
+    const int idx = m_count++;
+    Channel& channel = m_channels[idx];
+    channel.kuart = &kuart;
+    channel.weight = weight ? weight : 1;
+
+    kuart.on([this, idx](int len, uint8_t* data) {
+        _push(m_channels[idx], len, data);
+    });
+    return idx;
+}
+
+void UartMux::output(std::function<void(int len, uint8_t*)> foo)
+{
+    m_output = foo;
+}
+
+void UartMux::ready(std::function<bool(int len)> foo)
+{
+    m_ready = foo;
+}
+
+void UartMux::input(int len, uint8_t* data)
+{
+    if (len < 1 || data[0] >= m_count) {
+        return;
+    }
+
+    Channel& channel = m_channels[data[0]];
+    channel.kuart->write(len - 1, data + 1);
+    ++channel.stats.toUart;
+}
+
+void UartMux::proceed()
+{
+    // rx: same rotation as tx, no uart is always first
+    for (int i = 0; i < m_count; ++i) {
+        m_channels[(m_next + i) % m_count].kuart->proceed();
+    }
+
+    _schedule();
+}
+
+UartMuxChannelStats UartMux::stats(int channel) const
+{
+    if (channel < 0 || channel >= m_count) {
+        return UartMuxChannelStats();
+    }
+
+    UartMuxChannelStats stats = m_channels[channel].stats;
+    stats.highWater = m_channels[channel].queue.highWater();
+    return stats;
+}
+
+void UartMux::_push(Channel& channel, int len, uint8_t* data)
+{
+    ++channel.stats.framesIn;
+    if (len > UART_MUX_MAX_PAYLOAD || !channel.queue.push(data, len)) {
+        ++channel.stats.dropped;
+    }
+}
+
+// oldest frame of channel -> output(), returns bytes sent, -1 if queue is empty or
+// 0 if output is not ready (frame stays in queue)
+int UartMux::_send(int idx)
+{
+    Channel& channel = m_channels[idx];
+    if (m_ready) {
+        const int next = channel.queue.peekLen();
+        if (next < 0) {
+            return -1;
+        }
+        if (!m_ready(next + UART_MUX_HEADER)) {
+            ++channel.stats.waits;
+            return 0;
+        }
+    }
+
+    int len = channel.queue.pop(m_frame + UART_MUX_HEADER, UART_MUX_MAX_PAYLOAD);
+    if (len < 0) {
+        return -1;
+    }
+
+    m_frame[0] = UART_MUX_CMD;
+    m_frame[1] = static_cast<uint8_t>(idx);
+    len += UART_MUX_HEADER;
+    m_output(len, m_frame);
+
+    ++channel.stats.framesOut;
+    channel.stats.bytesOut += len;
+    return len;
+}
+
+void UartMux::_schedule()
+{
+    if (!m_output || m_count == 0) {
+        return;
+    }
+
+    int budget = m_budget > 0 ? m_budget : INT_MAX;
+
+    while (true) {
+        bool active = false;
+
+        for (int i = 0; i < m_count; ++i) {
+            const int idx = (m_next + i) % m_count;
+            Channel& channel = m_channels[idx];
+
+            if (m_scheduler == UART_MUX_ROUND_ROBIN) {
+                int sent = _send(idx);
+                if (sent == 0) {
+                    m_next = idx; // output is full, this channel goes first next time
+                    return;
+                }
+                if (sent > 0) {
+                    budget -= sent;
+                    active = true;
+                }
+            } else {
+                // deficit may go below zero by last frame, channel pays it back next round
+                channel.deficit += channel.weight * UART_MUX_QUANTUM;
+                while (channel.deficit > 0 && budget > 0) {
+                    int sent = _send(idx);
+                    if (sent == 0) {
+                        // output is full: credit is kept for next round, quantum is not added twice
+                        channel.deficit -= channel.weight * UART_MUX_QUANTUM;
+                        m_next = idx;
+                        return;
+                    }
+                    if (sent < 0) {
+                        channel.deficit = 0; // idle channel does not save credit
+                        break;
+                    }
+                    channel.deficit -= sent;
+                    budget -= sent;
+                    active = true;
+                }
+            }
+
+            if (budget <= 0) {
+                m_next = (idx + 1) % m_count;
+                return;
+            }
+        }
+
+        if (!active) {
+            return;
+        }
+        m_next = (m_next + 1) % m_count;
+    }
+}
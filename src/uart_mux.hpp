@@ -0,0 +1,106 @@
+#ifndef UART_MUX_H
+#define UART_MUX_H
+
+#include "kuart.hpp"
+#include "spsc_ring.h"
+
+/*
+ * Several UARTs over one network connection. Every frame carries channel id:
+ *
+ *  uart -> network : {UART_MUX_CMD}{channel}{uart frame}
+ *  network -> uart : {UART_MUX_CMD}{channel}{payload}   -> kuart[channel].write(payload)
+ *
+ * Decoded uart frames wait in per channel queue, proceed() moves them to output()
+ * (TcpClient::write(), UdpTransport::write(), ...) so all channels share one socket
+ * and its batching. Scheduler:
+ *  UART_MUX_ROUND_ROBIN - one frame per channel per round
+ *  UART_MUX_WEIGHTED    - deficit round robin, channel gets weight * UART_MUX_QUANTUM bytes per round
+ * Up to setBudget() bytes go out per proceed() call, rest waits in channel queues
+ * (new frames are dropped if queue is full). Round also stops when ready() says output
+ * can not take next frame (link down, TX queue full): frames wait in channel queues, so
+ * fairness holds while link is saturated, channel that was stopped goes first next time.
+ */
+
+#define UART_MUX_CMD 0xF5
+#define UART_MUX_HEADER 2
+#define UART_MUX_MAX_PAYLOAD (FRAME_CODEC_MAX_PAYLOAD - UART_MUX_HEADER)
+
+#ifndef UART_MUX_MAX_CHANNELS
+#   define UART_MUX_MAX_CHANNELS 3
+#endif /* UART_MUX_MAX_CHANNELS */
+
+#ifndef UART_MUX_QUEUE_SIZE
+#   define UART_MUX_QUEUE_SIZE 2048U    // bytes per channel (power of two)
+#endif /* UART_MUX_QUEUE_SIZE */
+
+#define UART_MUX_QUANTUM 256            // bytes per weight unit per round
+#define UART_MUX_TX_BUDGET 4096         // default bytes per proceed() call
+
+enum UartMuxScheduler
+{
+    UART_MUX_ROUND_ROBIN = 0,
+    UART_MUX_WEIGHTED
+};
+
+struct UartMuxChannelStats
+{
+    uint32_t framesIn = 0;      // frames decoded on uart
+    uint32_t framesOut = 0;     // frames given to output()
+    uint32_t bytesOut = 0;
+    uint32_t dropped = 0;       // channel queue full or frame too big for mux header
+    uint32_t waits = 0;         // frame waited because output was not ready
+    uint32_t toUart = 0;        // frames from network written to uart
+    uint32_t highWater = 0;     // max queue usage, bytes
+};
+
+class UartMux
+{
+public:
+    UartMux();
+
+    // returns channel id or -1 if all UART_MUX_MAX_CHANNELS are used, weight is for UART_MUX_WEIGHTED
+    int add(Kuart& kuart, uint8_t weight = 1);
+
+    void output(std::function<void(int len, uint8_t*)> foo);
+    // output can take frame of len bytes now (optional)
+    void ready(std::function<bool(int len)> foo);
+    inline void setScheduler(UartMuxScheduler scheduler) {m_scheduler = scheduler;}
+    inline void setBudget(int bytes) {m_budget = bytes;}
+
+    // UART_MUX_CMD handler for transport: {channel}{payload}
+    void input(int len, uint8_t* data);
+
+    // services uarts (rx) and moves queued frames to output()
+    void proceed();
+
+    inline int channels() const {return m_count;}
+    UartMuxChannelStats stats(int channel) const;
+
+private:
+    typedef SpscFrameRing<UART_MUX_QUEUE_SIZE> Queue;
+
+    struct Channel {
+        Kuart* kuart = nullptr;
+        uint8_t weight = 1;
+        int deficit = 0;
+        Queue queue;
+        UartMuxChannelStats stats;
+    };
+
+    void _push(Channel& channel, int len, uint8_t* data);
+    int _send(int idx);
+    void _schedule();
+
+    Channel m_channels[UART_MUX_MAX_CHANNELS];
+    int m_count = 0;
+    int m_next = 0;             // first channel of next round
+
+    UartMuxScheduler m_scheduler = UART_MUX_ROUND_ROBIN;
+    int m_budget = UART_MUX_TX_BUDGET;
+    std::function<void(int len, uint8_t*)> m_output = nullptr;
+    std::function<bool(int len)> m_ready = nullptr;
+
+    uint8_t m_frame[FRAME_CODEC_MAX_PAYLOAD];
+};
+
+#endif /* UART_MUX_H */